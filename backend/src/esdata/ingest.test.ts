@@ -0,0 +1,67 @@
+import assert from "assert"
+import fs from "fs"
+import os from "os"
+import path from "path"
+import { allowRequest, flushIngest, ingestBatch, ingestReport, setIngestPersistence } from "./ingest"
+import { EsdataPersistence } from "./persistence"
+import { changesSince, currentVersion, euroscopeData, type EsdataEntries } from "./store"
+
+// Writes to the same callsign within the window are coalesced, last write wins
+const v1 = currentVersion()
+ingestBatch({ SAS123: { stand: "F32", groundstate: "PUSH" }, NAX456: { stand: "F34" } }, { client: "a" })
+ingestBatch({ SAS123: { groundstate: "TAXI" } }, { client: "b" })
+assert.strictEqual(euroscopeData.SAS123, undefined) // not merged until flushed
+flushIngest()
+assert.strictEqual(euroscopeData.SAS123.stand, "F32")
+assert.strictEqual(euroscopeData.SAS123.groundstate, "TAXI")
+assert.strictEqual(euroscopeData.SAS123.count, 2)
+assert.strictEqual(euroscopeData.SAS123.timestamp, euroscopeData.NAX456.timestamp)
+assert.deepStrictEqual(Object.keys(changesSince(euroscopeData, v1).changed).sort(), ["NAX456", "SAS123"])
+
+let report = ingestReport()
+assert.strictEqual(report.batches, 2)
+assert.strictEqual(report.writes, 3)
+assert.strictEqual(report.coalescedWrites, 1)
+assert.strictEqual(report.flushes, 1)
+
+// The buffered update must not be shared with the caller's batch
+const batch = { SAS123: { stand: "F36" } }
+ingestBatch(batch, undefined)
+ingestBatch({ SAS123: { stand: "F38" } }, undefined)
+assert.strictEqual(batch.SAS123.stand, "F36")
+flushIngest()
+assert.strictEqual(euroscopeData.SAS123.stand, "F38")
+
+// Token bucket: a burst of 20, then 5 per second
+const start = 1_000_000
+let allowed = 0
+for (let i = 0; i < 30; i++) if (allowRequest("client", start)) allowed++
+assert.strictEqual(allowed, 20)
+assert.strictEqual(allowRequest("client", start + 100), false)
+assert.strictEqual(allowRequest("client", start + 200), true)
+assert.strictEqual(allowRequest("other", start), true)
+report = ingestReport()
+assert.strictEqual(report.rateLimited, 11)
+
+// A flood of new clients evicts the least recently used buckets, not the active ones
+for (let i = 0; i < 9998; i++) allowRequest(`flood${i}`, start)
+assert.strictEqual(allowRequest("client", start + 200), false)
+allowRequest("flood-last", start)
+assert.strictEqual(allowRequest("client", start + 200), false)
+assert.strictEqual(ingestReport().rateLimit.clients, 10000)
+
+// Restoring the log gives the same counts as the live store, coalesced writes included
+const dir = fs.mkdtempSync(path.join(os.tmpdir(), "esdata-ingest-test-"))
+const persistence = new EsdataPersistence(dir, euroscopeData)
+persistence.restore()
+setIngestPersistence(persistence)
+ingestBatch({ SAS789: { groundstate: "LINEUP" }, NAX790: { stand: "F40" } }, undefined)
+ingestBatch({ SAS789: { groundstate: "DEPA" } }, undefined)
+flushIngest()
+const restored: EsdataEntries = {}
+new EsdataPersistence(dir, restored).restore()
+assert.deepStrictEqual(restored, { SAS789: euroscopeData.SAS789, NAX790: euroscopeData.NAX790 })
+assert.strictEqual(restored.SAS789.count, 2)
+setIngestPersistence(null)
+persistence.close()
+fs.rmSync(dir, { recursive: true, force: true })
@@ -0,0 +1,137 @@
+import moment from "moment"
+import { monitorEventLoopDelay } from "perf_hooks"
+import { applyUpdate, euroscopeData, markChanged } from "./store"
+import { recordTrace } from "./latency"
+import type { EsdataPersistence } from "./persistence"
+
+// Ingestion stage for POST /esdata. Batches from all plugins are buffered for a short window,
+// duplicate callsign/field writes within it are coalesced (last write wins, as with sequential
+// merges), and the result is applied in one merge pass with a single timestamp and a single log
+// append. Each client address is rate limited by a token bucket.
+
+export const INGEST_WINDOW_MS = parseInt(process.env.ESDATA_INGEST_WINDOW_MS || "100", 10) || 0
+const RATE_LIMIT_BURST = parseInt(process.env.ESDATA_RATE_LIMIT_BURST || "20", 10) || 20
+const RATE_LIMIT_PER_SEC = parseFloat(process.env.ESDATA_RATE_LIMIT_PER_SEC || "5") || 5
+const MAX_BUCKETS = 10000 // least recently used ones are evicted beyond this
+const EVENT_LOOP_RESOLUTION_MS = 10
+
+interface PendingWrite {
+    update: { [field: string]: any }
+    writes: number
+}
+
+interface PendingTrace {
+    trace: any
+    receivedAt: number
+}
+
+let persistence: EsdataPersistence | null = null
+let pending = new Map<string, PendingWrite>()
+let pendingTraces = [] as PendingTrace[]
+let flushTimer: NodeJS.Timeout | null = null
+const buckets = new Map<string, { tokens: number; updatedAt: number }>()
+const stats = { batches: 0, writes: 0, coalescedWrites: 0, flushes: 0, rateLimited: 0 }
+
+const eventLoopDelay = monitorEventLoopDelay({ resolution: EVENT_LOOP_RESOLUTION_MS })
+eventLoopDelay.enable()
+
+export function setIngestPersistence(target: EsdataPersistence | null) {
+    persistence = target
+}
+
+// Returns false if the client is over its rate and the request should be rejected
+export function allowRequest(client: string, now = Date.now()) {
+    let bucket = buckets.get(client)
+    if (bucket) {
+        buckets.delete(client) // re-inserted below, keeping the map in least recently used order
+    } else {
+        if (buckets.size >= MAX_BUCKETS) buckets.delete(buckets.keys().next().value!)
+        bucket = { tokens: RATE_LIMIT_BURST, updatedAt: now }
+    }
+    buckets.set(client, bucket)
+    bucket.tokens = Math.min(RATE_LIMIT_BURST, bucket.tokens + ((now - bucket.updatedAt) / 1000) * RATE_LIMIT_PER_SEC)
+    bucket.updatedAt = now
+    if (bucket.tokens < 1) {
+        stats.rateLimited++
+        return false
+    }
+    bucket.tokens--
+    return true
+}
+
+export function ingestBatch(batch: { [key: string]: any }, trace: any, receivedAt = Date.now()) {
+    stats.batches++
+    for (const key in batch) {
+        const update = batch[key]
+        const write = pending.get(key)
+        if (write) {
+            Object.assign(write.update, update)
+            write.writes++
+            stats.coalescedWrites++
+        } else {
+            pending.set(key, { update: { ...update }, writes: 1 })
+        }
+        stats.writes++
+    }
+    pendingTraces.push({ trace, receivedAt })
+
+    if (INGEST_WINDOW_MS <= 0) flushIngest()
+    else if (!flushTimer) flushTimer = setTimeout(flushIngest, INGEST_WINDOW_MS)
+}
+
+export function flushIngest() {
+    if (flushTimer) clearTimeout(flushTimer)
+    flushTimer = null
+    if (pending.size == 0 && pendingTraces.length == 0) return
+
+    const writes = pending
+    const traces = pendingTraces
+    pending = new Map()
+    pendingTraces = []
+    stats.flushes++
+
+    const timestamp = moment().utc().toISOString()
+    const batch = {} as { [key: string]: any }
+    const counts = {} as { [key: string]: number }
+    for (const [key, write] of writes) {
+        applyUpdate(euroscopeData, key, write.update, timestamp, write.writes)
+        markChanged(key)
+        batch[key] = write.update
+        if (write.writes > 1) counts[key] = write.writes
+    }
+    const w = Object.keys(counts).length > 0 ? counts : undefined // left out of the log record when undefined
+    if (writes.size > 0) persistence?.append({ t: timestamp, b: batch, w })
+
+    // Runs from a timer, where a throw would take the process down
+    const mergedAt = Date.now()
+    for (const { trace, receivedAt } of traces) {
+        try {
+            recordTrace(trace, receivedAt, mergedAt)
+        } catch (e) {
+            console.error("esdata: failed to record trace", e)
+        }
+    }
+}
+
+export function ingestReport() {
+    return {
+        windowMs: INGEST_WINDOW_MS,
+        rateLimit: { burst: RATE_LIMIT_BURST, perSec: RATE_LIMIT_PER_SEC, clients: buckets.size },
+        ...stats,
+        eventLoopDelayMs: {
+            p50: loopDelayMs(eventLoopDelay.percentile(50)),
+            p99: loopDelayMs(eventLoopDelay.percentile(99)),
+            max: loopDelayMs(eventLoopDelay.max),
+        },
+    }
+}
+
+// The histogram measures the whole sampling interval, so subtract it to get the actual delay
+function loopDelayMs(ns: number) {
+    return Math.max(0, ns / 1e6 - EVENT_LOOP_RESOLUTION_MS)
+}
+
+export function resetIngestStats() {
+    for (const key in stats) stats[key as keyof typeof stats] = 0
+    eventLoopDelay.reset()
+}
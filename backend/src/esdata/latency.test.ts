@@ -0,0 +1,89 @@
+import assert from "assert"
+import { LatencyHistogram, latencyReport, recordTrace, resetLatency } from "./latency"
+
+const histogram = new LatencyHistogram()
+assert.strictEqual(histogram.percentile(99), 0)
+for (let ms = 1; ms <= 100; ms++) histogram.record(ms * 30)
+assert.strictEqual(histogram.percentile(50), 2000)
+assert.strictEqual(histogram.percentile(99), 3000)
+assert.strictEqual(histogram.max, 3000)
+histogram.record(-50)
+assert.strictEqual(histogram.counts[0], 1)
+
+resetLatency()
+const t0 = Date.UTC(2026, 4, 23, 10, 0, 0)
+const fields = { SAS123: { clearence: [t0, 5], squawk: [t0 + 100, 6] } }
+recordTrace({ client: "ESSA_TWR", enqueued: t0 + 800, sent: t0 + 850, rtt: 200, fields }, t0 + 950, t0 + 951)
+let report = latencyReport()
+assert.strictEqual(report.traces, 1)
+assert.strictEqual(report.reordered, 0)
+assert.strictEqual(report.slo.count, 1)
+assert.strictEqual(report.slo.actual, 951) // 850 on the plugin + 200 / 2 network + 1 here
+assert.strictEqual(report.slo.ok, true)
+assert.strictEqual(report.stages["plugin capture-enqueue"].count, 2)
+assert.strictEqual(report.stages["cross-clock network send-receive"].max, 100)
+assert.strictEqual(report.stages["network rtt/2"].max, 100)
+
+// The SLO doesn't depend on the plugin's clock, only the cross-clock diagnostics do
+const skewed = (skew: number) => {
+    resetLatency()
+    const at = (ms: number) => t0 + ms + skew
+    const trace = { enqueued: at(800), sent: at(850), rtt: 200, fields: { SAS123: { clearence: [at(0), 1] } } }
+    recordTrace(trace, t0 + 950, t0 + 951)
+    return latencyReport()
+}
+report = skewed(-10000) // plugin clock 10 s behind
+assert.strictEqual(report.slo.actual, 951)
+assert.strictEqual(report.stages["cross-clock end-to-end"].max, 10951)
+report = skewed(10000) // ahead
+assert.strictEqual(report.slo.actual, 951)
+assert.strictEqual(report.stages["cross-clock end-to-end"].max, 0)
+
+// The first post from a plugin has no round trip yet and only counts towards the diagnostics
+resetLatency()
+recordTrace({ enqueued: t0 + 800, sent: t0 + 850, fields }, t0 + 950, t0 + 951)
+report = latencyReport()
+assert.strictEqual(report.slo.count, 0)
+assert.strictEqual(report.stages["cross-clock end-to-end"].count, 2)
+recordTrace({ client: "ESSA_TWR", enqueued: t0 + 800, sent: t0 + 850, rtt: 200, fields }, t0 + 950, t0 + 951)
+
+// An older batch from the same plugin arriving late
+recordTrace(
+    { client: "ESSA_TWR", enqueued: t0, sent: t0, rtt: 2000, fields: { NAX456: { clearence: [t0 - 5000, 4] } } },
+    t0 + 1000,
+    t0 + 1000,
+)
+report = latencyReport()
+assert.strictEqual(report.reordered, 1)
+assert.strictEqual(report.slo.ok, false)
+
+// Batches from plugins without tracing only count the backend stage
+recordTrace(undefined, t0, t0 + 2)
+assert.strictEqual(latencyReport().traces, 3)
+assert.strictEqual(latencyReport().stages["backend receive-merge"].count, 4)
+
+// Malformed traces from the request body are skipped, not thrown on
+resetLatency()
+for (const trace of [
+    { fields: { X: { clearence: 5 } } },
+    { fields: { X: { clearence: [t0] } } },
+    { fields: { X: "clearence" } },
+    { fields: "X" },
+    { fields: null },
+    "trace",
+    [1, 2],
+]) {
+    recordTrace(trace, t0, t0 + 1)
+}
+report = latencyReport()
+assert.strictEqual(report.traces, 5)
+assert.strictEqual(report.stages["end-to-end"], undefined)
+assert.strictEqual(report.stages["cross-clock end-to-end"], undefined)
+
+// Only the urgent fields get a histogram of their own
+const urgent = { SAS123: { clearence: [t0, 1], groundstate: [t0, 2], ["x".repeat(100)]: [t0, 3] } }
+recordTrace({ sent: t0, rtt: 0, fields: urgent }, t0, t0 + 1)
+assert.deepStrictEqual(Object.keys(latencyReport().stages).filter((stage) => stage.startsWith("end-to-end ")), [
+    "end-to-end clearence",
+    "end-to-end groundstate",
+])
@@ -0,0 +1,127 @@
+// Latency histograms per stage of the plugin → backend pipeline, from the _trace the EuroScope
+// plugin adds to each batch (see euroscope-plugin/src/latency.h, which uses the same buckets).
+// End-to-end latency is summed from segments each timed on one clock: capture-send on the plugin,
+// half the plugin's last round trip for the network, receive-merge here. The cross-clock stages
+// compare the plugin's wall clock with ours, so they include any skew between them - diagnostics only.
+
+const BUCKET_LIMITS_MS = [10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 15000, 20000, 30000, 60000, 120000]
+
+export const LATENCY_SLO = { stage: "end-to-end clearence", percentile: 99, ms: 2000 }
+// Fields with their own end-to-end histogram - the plugin's urgent fields (IsUrgentField)
+const PER_FIELD_STAGES = ["clearence", "groundstate"]
+const MAX_CLIENTS = 10000
+
+export class LatencyHistogram {
+    counts = new Array(BUCKET_LIMITS_MS.length + 1).fill(0)
+    count = 0
+    max = 0
+
+    record(ms: number) {
+        if (!(ms > 0)) ms = 0 // cross-clock skew, or NaN from a malformed trace
+        let bucket = 0
+        while (bucket < BUCKET_LIMITS_MS.length && ms > BUCKET_LIMITS_MS[bucket]) bucket++
+        this.counts[bucket]++
+        this.count++
+        if (ms > this.max) this.max = ms
+    }
+
+    // Upper bound of the bucket holding the percentile
+    percentile(percentile: number) {
+        if (this.count == 0) return 0
+        const target = Math.max(1, Math.round((percentile / 100) * this.count))
+        let seen = 0
+        for (let bucket = 0; bucket < BUCKET_LIMITS_MS.length; bucket++) {
+            seen += this.counts[bucket]
+            if (seen >= target) return Math.min(BUCKET_LIMITS_MS[bucket], this.max)
+        }
+        return this.max
+    }
+
+    toJSON() {
+        return { count: this.count, p50: this.percentile(50), p90: this.percentile(90), p99: this.percentile(99), max: this.max }
+    }
+}
+
+const stages = new Map<string, LatencyHistogram>()
+const lastSeqByClient = new Map<string, number>()
+let traces = 0
+let reordered = 0
+
+export function recordLatency(stage: string, ms: number) {
+    let histogram = stages.get(stage)
+    if (!histogram) stages.set(stage, (histogram = new LatencyHistogram()))
+    histogram.record(ms)
+}
+
+function isObject(value: any) {
+    return value !== null && typeof value == "object" && !Array.isArray(value)
+}
+
+function isStamp(stamp: any) {
+    return Array.isArray(stamp) && typeof stamp[0] == "number" && typeof stamp[1] == "number"
+}
+
+// trace: { client, enqueued, sent, rtt, fields: { callsign: { field: [capturedAt, seq] } } }
+// rtt is the plugin's previous send-response time, missing on its first post.
+// The trace comes straight from the request body, so anything malformed is skipped
+export function recordTrace(trace: any, receivedAt: number, mergedAt: number) {
+    const backend = mergedAt - receivedAt
+    recordLatency("backend receive-merge", backend)
+    if (!isObject(trace)) return
+    traces++
+
+    const sent = typeof trace.sent == "number" ? trace.sent : undefined
+    const network = typeof trace.rtt == "number" && trace.rtt >= 0 ? trace.rtt / 2 : undefined
+    if (typeof trace.enqueued == "number" && sent !== undefined) recordLatency("plugin enqueue-send", sent - trace.enqueued)
+    if (sent !== undefined) recordLatency("cross-clock network send-receive", receivedAt - sent)
+    if (network !== undefined) recordLatency("network rtt/2", network)
+
+    let minSeq = Infinity
+    let maxSeq = 0
+    const traceFields = isObject(trace.fields) ? trace.fields : {}
+    for (const callsign in traceFields) {
+        const fields = traceFields[callsign]
+        if (!isObject(fields)) continue
+        for (const field in fields) {
+            if (!isStamp(fields[field])) continue
+            const [capturedAt, seq] = fields[field]
+            if (typeof trace.enqueued == "number") recordLatency("plugin capture-enqueue", trace.enqueued - capturedAt)
+            recordLatency("cross-clock end-to-end", mergedAt - capturedAt)
+            // Without both plugin timestamps there is no same-clock figure to count towards the SLO
+            if (sent !== undefined && network !== undefined) {
+                const endToEnd = sent - capturedAt + network + backend
+                recordLatency("end-to-end", endToEnd)
+                if (PER_FIELD_STAGES.includes(field)) recordLatency(`end-to-end ${field}`, endToEnd)
+            }
+            minSeq = Math.min(minSeq, seq)
+            maxSeq = Math.max(maxSeq, seq)
+        }
+    }
+
+    // Batches from one plugin should arrive in order - count those overtaken by a later one
+    if (typeof trace.client == "string" && maxSeq > 0) {
+        const lastSeq = lastSeqByClient.get(trace.client) || 0
+        if (minSeq <= lastSeq) reordered++
+        lastSeqByClient.delete(trace.client) // re-insert, so the first one is the least recently seen
+        if (lastSeqByClient.size >= MAX_CLIENTS) lastSeqByClient.delete(lastSeqByClient.keys().next().value!)
+        lastSeqByClient.set(trace.client, Math.max(lastSeq, maxSeq))
+    }
+}
+
+export function latencyReport() {
+    const slo = stages.get(LATENCY_SLO.stage)
+    const actual = slo ? slo.percentile(LATENCY_SLO.percentile) : 0
+    return {
+        slo: { ...LATENCY_SLO, count: slo?.count || 0, actual, ok: actual <= LATENCY_SLO.ms },
+        traces,
+        reordered,
+        stages: Object.fromEntries([...stages.entries()].sort(([a], [b]) => a.localeCompare(b))),
+    }
+}
+
+export function resetLatency() {
+    stages.clear()
+    lastSeqByClient.clear()
+    traces = 0
+    reordered = 0
+}
@@ -0,0 +1,61 @@
+import assert from "assert"
+import fs from "fs"
+import os from "os"
+import path from "path"
+import { EsdataPersistence } from "./persistence"
+import { applyUpdate, type EsdataEntries } from "./store"
+
+const dir = fs.mkdtempSync(path.join(os.tmpdir(), "esdata-test-"))
+
+function post(persistence: EsdataPersistence, batch: { [key: string]: any }, timestamp: string) {
+    for (const key in batch) applyUpdate(persistence.entries, key, batch[key], timestamp)
+    persistence.append({ t: timestamp, b: batch })
+}
+
+function restored(): EsdataEntries {
+    const entries: EsdataEntries = {}
+    const persistence = new EsdataPersistence(dir, entries)
+    persistence.restore()
+    persistence.close()
+    return entries
+}
+
+async function main() {
+    const entries: EsdataEntries = {}
+    const first = new EsdataPersistence(dir, entries)
+    assert.strictEqual(first.restore().entries, 0)
+
+    post(first, { SAS123: { squawk: "1234", stand: "F32" } }, "2026-05-23T10:00:00.000Z")
+    post(first, { SAS123: { cfl: 5000 }, ESSA_TWR: { frequency: 118.5 } }, "2026-05-23T10:00:05.000Z")
+    await first.snapshot()
+    post(first, { SAS123: { squawk: "4321" } }, "2026-05-23T10:00:10.000Z")
+    delete entries.ESSA_TWR
+    first.append({ t: "2026-05-23T10:00:15.000Z", d: "ESSA_TWR" })
+
+    // Crash: no close, so the last records only exist in the log
+    const afterCrash = restored()
+    assert.deepStrictEqual(afterCrash, entries)
+    assert.strictEqual(afterCrash.SAS123.squawk, "4321")
+    assert.strictEqual(afterCrash.SAS123.stand, "F32")
+    assert.strictEqual(afterCrash.SAS123.count, 3)
+    assert.strictEqual(afterCrash.SAS123.timestamp, "2026-05-23T10:00:10.000Z")
+    assert.ok(!("ESSA_TWR" in afterCrash))
+
+    // A line torn by a crash mid-write is skipped, not fatal
+    const logs = fs.readdirSync(dir).filter((file) => file.startsWith("log-"))
+    fs.appendFileSync(path.join(dir, logs[logs.length - 1]), '{"t":"2026-05-23T10:00:20.000Z","b":{"SAS1')
+    const torn: EsdataEntries = {}
+    const tornPersistence = new EsdataPersistence(dir, torn)
+    const result = tornPersistence.restore()
+    assert.strictEqual(result.skippedRecords, 1)
+    assert.deepStrictEqual(torn, entries)
+
+    // Clean shutdown leaves just a snapshot and an empty log
+    tornPersistence.close()
+    assert.deepStrictEqual(fs.readdirSync(dir).filter((file) => file.startsWith("log-")).length, 1)
+    assert.deepStrictEqual(restored(), entries)
+
+    fs.rmSync(dir, { recursive: true, force: true })
+}
+
+main()
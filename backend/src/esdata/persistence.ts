@@ -0,0 +1,166 @@
+import fs from "fs"
+import path from "path"
+import { applyUpdate, type EsdataEntries } from "./store"
+
+// State survives restarts as a compact snapshot plus an append-only log of merged updates.
+// Each snapshot starts a new log generation; restoring reads the snapshot and replays the logs
+// of that generation and later, so a crash at any point loses at most a partially written line.
+
+export const SNAPSHOT_INTERVAL_MS = (parseInt(process.env.ESDATA_SNAPSHOT_INTERVAL_SEC || "60", 10) || 60) * 1000
+export const SNAPSHOT_MAX_LOG_RECORDS = parseInt(process.env.ESDATA_SNAPSHOT_MAX_LOG_RECORDS || "2000", 10) || 2000
+
+const SNAPSHOT_FILE = "snapshot.json"
+const LOG_FILE_PATTERN = /^log-(\d+)\.jsonl$/
+
+// w: number of coalesced writes per key, where more than one (see ingest.ts)
+export type LogRecord = { t: string; b: { [key: string]: any }; w?: { [key: string]: number } } | { t: string; d: string }
+
+export interface RestoreResult {
+    snapshotEntries: number
+    logRecords: number
+    skippedRecords: number
+    entries: number
+    ms: number
+}
+
+function logFileName(generation: number) {
+    return `log-${generation}.jsonl`
+}
+
+export function applyLogRecord(entries: EsdataEntries, record: LogRecord) {
+    if ("b" in record) {
+        for (const key in record.b) applyUpdate(entries, key, record.b[key], record.t, record.w?.[key] || 1)
+    } else if ("d" in record) {
+        delete entries[record.d]
+    }
+}
+
+export class EsdataPersistence {
+    private generation = 0
+    private logFd: number | null = null
+    private logRecords = 0
+    private snapshotting = false
+    private timer: NodeJS.Timeout | null = null
+
+    constructor(
+        readonly dir: string,
+        readonly entries: EsdataEntries,
+    ) {}
+
+    restore(): RestoreResult {
+        const start = process.hrtime.bigint()
+        fs.mkdirSync(this.dir, { recursive: true })
+        const result = { snapshotEntries: 0, logRecords: 0, skippedRecords: 0, entries: 0, ms: 0 }
+
+        let snapshotGeneration = 0
+        const snapshotPath = path.join(this.dir, SNAPSHOT_FILE)
+        if (fs.existsSync(snapshotPath)) {
+            try {
+                const snapshot = JSON.parse(fs.readFileSync(snapshotPath, "utf8"))
+                snapshotGeneration = snapshot.generation || 0
+                Object.assign(this.entries, snapshot.entries)
+                result.snapshotEntries = Object.keys(snapshot.entries || {}).length
+            } catch (e) {
+                console.error("esdata: failed to read snapshot, replaying logs only", e)
+            }
+        }
+
+        let lastGeneration = snapshotGeneration
+        for (const generation of this.logGenerations()) {
+            if (generation < snapshotGeneration) continue
+            lastGeneration = Math.max(lastGeneration, generation)
+            const lines = fs.readFileSync(path.join(this.dir, logFileName(generation)), "utf8").split("\n")
+            for (const line of lines) {
+                if (!line) continue
+                try {
+                    applyLogRecord(this.entries, JSON.parse(line))
+                    result.logRecords++
+                } catch (e) {
+                    result.skippedRecords++ // typically a line torn by a crash mid-write
+                }
+            }
+        }
+
+        // Continue in a fresh log, older ones are removed by the next snapshot
+        this.openLog(lastGeneration + 1)
+        this.logRecords = result.logRecords + result.skippedRecords
+
+        result.entries = Object.keys(this.entries).length
+        result.ms = Number(process.hrtime.bigint() - start) / 1e6
+        return result
+    }
+
+    append(record: LogRecord) {
+        if (this.logFd === null) return
+        fs.writeSync(this.logFd, JSON.stringify(record) + "\n")
+        this.logRecords++
+        if (this.logRecords >= SNAPSHOT_MAX_LOG_RECORDS) setImmediate(() => this.snapshot())
+    }
+
+    // Serialization and log rotation happen synchronously, so the snapshot holds exactly the
+    // records of the previous generations. Only the file write is asynchronous.
+    async snapshot() {
+        if (this.snapshotting || this.logFd === null) return
+        this.snapshotting = true
+        try {
+            const snapshotPath = path.join(this.dir, SNAPSHOT_FILE)
+            const json = this.rotate()
+            await fs.promises.writeFile(snapshotPath + ".tmp", json)
+            await fs.promises.rename(snapshotPath + ".tmp", snapshotPath)
+            this.removeLogsBefore(this.generation)
+        } catch (e) {
+            console.error("esdata: snapshot failed", e)
+        } finally {
+            this.snapshotting = false
+        }
+    }
+
+    start(intervalMs = SNAPSHOT_INTERVAL_MS) {
+        this.timer = setInterval(() => {
+            if (this.logRecords > 0) this.snapshot()
+        }, intervalMs)
+        this.timer.unref()
+    }
+
+    // Final synchronous snapshot, e.g. on SIGTERM from systemctl restart
+    close() {
+        if (this.timer) clearInterval(this.timer)
+        this.timer = null
+        if (this.logFd === null) return
+        if (this.logRecords > 0 && !this.snapshotting) {
+            const snapshotPath = path.join(this.dir, SNAPSHOT_FILE)
+            fs.writeFileSync(snapshotPath + ".tmp", this.rotate())
+            fs.renameSync(snapshotPath + ".tmp", snapshotPath)
+            this.removeLogsBefore(this.generation)
+        }
+        fs.closeSync(this.logFd)
+        this.logFd = null
+    }
+
+    private rotate() {
+        this.openLog(this.generation + 1)
+        this.logRecords = 0
+        return JSON.stringify({ generation: this.generation, savedAt: new Date().toISOString(), entries: this.entries })
+    }
+
+    private openLog(generation: number) {
+        if (this.logFd !== null) fs.closeSync(this.logFd)
+        this.generation = generation
+        this.logFd = fs.openSync(path.join(this.dir, logFileName(generation)), "a")
+    }
+
+    private logGenerations() {
+        return fs
+            .readdirSync(this.dir)
+            .map((file) => LOG_FILE_PATTERN.exec(file))
+            .filter((match) => match !== null)
+            .map((match) => parseInt(match![1], 10))
+            .sort((a, b) => a - b)
+    }
+
+    private removeLogsBefore(generation: number) {
+        for (const logGeneration of this.logGenerations()) {
+            if (logGeneration < generation) fs.unlinkSync(path.join(this.dir, logFileName(logGeneration)))
+        }
+    }
+}
@@ -0,0 +1,108 @@
+import { fork } from "child_process"
+import fs from "fs"
+import os from "os"
+import path from "path"
+import { EsdataPersistence } from "../persistence"
+import { applyUpdate, type EsdataEntries } from "../store"
+
+// Crash/restart benchmark. A child process fills the store the same way POST /esdata does, gets
+// killed with SIGKILL (so no final snapshot), and the parent times restoring its state.
+//
+//   npx tsx src/esdata/scripts/bench-restart.ts [callsigns] [batches after snapshot]
+
+const CALLSIGNS = parseInt(process.argv[2] || "10000", 10)
+const BATCHES_AFTER_SNAPSHOT = parseInt(process.argv[3] || "2000", 10)
+const BATCH_SIZE = 20
+const RESTORE_RUNS = 5
+
+function sampleUpdate(i: number) {
+    return {
+        controller: `ESSA_${i % 20}_TWR`,
+        squawk: String(1000 + (i % 6777)),
+        rfl: 30000 + (i % 10) * 1000,
+        cfl: 5000,
+        sid: "LAKE1A",
+        depRwy: "01L",
+        groundstate: "TAXI",
+        clearence: i % 2 == 0,
+        asp: 250,
+        stand: `F${i % 60}`,
+    }
+}
+
+async function writer(dir: string, snapshot: boolean) {
+    const entries: EsdataEntries = {}
+    const persistence = new EsdataPersistence(dir, entries)
+    persistence.restore()
+
+    let batches = 0
+    const post = (callsigns: number[]) => {
+        const timestamp = new Date(Date.UTC(2026, 4, 23, 10, 0, batches++)).toISOString()
+        const batch = {} as { [key: string]: any }
+        for (const i of callsigns) batch[`CS${i}`] = sampleUpdate(i + batches)
+        for (const key in batch) applyUpdate(entries, key, batch[key], timestamp)
+        persistence.append({ t: timestamp, b: batch })
+    }
+
+    for (let i = 0; i < CALLSIGNS; i += BATCH_SIZE) {
+        post(Array.from({ length: Math.min(BATCH_SIZE, CALLSIGNS - i) }, (_, j) => i + j))
+    }
+    if (snapshot) await persistence.snapshot()
+    for (let n = 0; n < BATCHES_AFTER_SNAPSHOT; n++) {
+        post(Array.from({ length: BATCH_SIZE }, () => Math.floor(Math.random() * CALLSIGNS)))
+    }
+
+    process.send!(Object.keys(entries).length)
+    setInterval(() => {}, 1000) // ... until killed
+}
+
+function runWriter(dir: string, snapshot: boolean): Promise<number> {
+    return new Promise((resolve, reject) => {
+        const child = fork(__filename, process.argv.slice(2), {
+            env: { ...process.env, BENCH_WRITER_DIR: dir, BENCH_WRITER_SNAPSHOT: snapshot ? "1" : "" },
+        })
+        let entries = 0
+        child.on("message", (message) => {
+            entries = message as number
+            child.kill("SIGKILL")
+        })
+        child.on("exit", (code, signal) => (signal == "SIGKILL" ? resolve(entries) : reject(new Error(`writer exited ${code}`))))
+    })
+}
+
+function dirSize(dir: string) {
+    return fs.readdirSync(dir).reduce((size, file) => size + fs.statSync(path.join(dir, file)).size, 0)
+}
+
+async function scenario(name: string, snapshot: boolean) {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), "esdata-bench-"))
+    const expected = await runWriter(dir, snapshot)
+    const size = dirSize(dir)
+
+    const times = [] as number[]
+    let result
+    for (let run = 0; run < RESTORE_RUNS; run++) {
+        const entries: EsdataEntries = {}
+        result = new EsdataPersistence(dir, entries).restore()
+        if (result.entries != expected) throw new Error(`${name}: restored ${result.entries} entries, expected ${expected}`)
+        times.push(result.ms)
+    }
+    times.sort((a, b) => a - b)
+    console.log(
+        `${name.padEnd(16)} ${result!.entries} entries, ${result!.logRecords} log records, ${(size / 1e6).toFixed(1)} MB on disk` +
+            ` → restore min ${times[0].toFixed(1)} ms, median ${times[Math.floor(times.length / 2)].toFixed(1)} ms`,
+    )
+    fs.rmSync(dir, { recursive: true, force: true })
+}
+
+async function main() {
+    if (process.env.BENCH_WRITER_DIR) return writer(process.env.BENCH_WRITER_DIR, !!process.env.BENCH_WRITER_SNAPSHOT)
+    console.log(`Crash/restart with ${CALLSIGNS} callsigns, batches of ${BATCH_SIZE}, ${BATCHES_AFTER_SNAPSHOT} batches after snapshot`)
+    await scenario("snapshot + log", true)
+    await scenario("log only", false)
+}
+
+main().catch((e) => {
+    console.error(e)
+    process.exit(1)
+})
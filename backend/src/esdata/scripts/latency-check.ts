@@ -0,0 +1,139 @@
+import express from "express"
+import bodyparser from "body-parser"
+
+// Checks the end-to-end latency SLO (LATENCY_SLO in ../latency.ts) against the plugin's posting
+// policy. Simulated plugins capture field changes at random times and post them like
+// VatIRISPlugin::OnTimer does: urgent fields (clearence, groundstate) on the next 1 s timer tick
+// in a new second, everything else after 5-15 s, never while a post is still in flight. Posts
+// and their responses are delayed by a simulated network transit, and each plugin's clock is off
+// by a random skew - the SLO must not depend on it, only the cross-clock diagnostics do.
+//
+//   npx tsx src/esdata/scripts/latency-check.ts [plugins] [seconds] [max network ms] [max clock skew ms]
+
+const PLUGINS = parseInt(process.argv[2] || "50", 10)
+const DURATION_S = parseInt(process.argv[3] || "60", 10)
+const MAX_NETWORK_MS = parseInt(process.argv[4] || "300", 10)
+const MAX_SKEW_MS = parseInt(process.argv[5] || "5000", 10)
+const CAPTURES_PER_MINUTE = 20 // per plugin
+const URGENT_SHARE = 0.5
+const statuses = ["ONFREQ", "DE-ICE", "STUP", "PUSH", "TAXI", "LINEUP", "DEPA"]
+
+const sleep = (ms: number) => new Promise((resolve) => setTimeout(resolve, ms))
+
+class SimulatedPlugin {
+    pending = {} as { [callsign: string]: any }
+    trace = {} as { [callsign: string]: { [field: string]: [number, number] } }
+    urgentPending = false
+    lastPostSecond = 0
+    posting = false
+    seq = 0
+    rtt = -1
+    readonly skew = Math.round((Math.random() * 2 - 1) * MAX_SKEW_MS)
+
+    constructor(
+        readonly client: string,
+        readonly base: string,
+    ) {}
+
+    now() {
+        return Date.now() + this.skew
+    }
+
+    capture(callsign: string, field: string, value: any) {
+        ;(this.pending[callsign] ||= {})[field] = value
+        const stamps = (this.trace[callsign] ||= {})
+        if (stamps[field]) stamps[field][1] = ++this.seq
+        else stamps[field] = [this.now(), ++this.seq]
+        if (field == "clearence" || field == "groundstate") this.urgentPending = true
+    }
+
+    tick() {
+        const second = Math.floor(Date.now() / 1000)
+        if (Object.keys(this.pending).length == 0) return
+        if (this.urgentPending) {
+            if (second - this.lastPostSecond < 1) return
+        } else if (second - this.lastPostSecond < 5 + Math.floor(Math.random() * 10)) {
+            return
+        }
+        this.lastPostSecond = second
+        if (this.posting) return // try-lock failed, stays pending
+        this.post()
+    }
+
+    async post() {
+        const enqueued = this.now()
+        const _trace = { client: this.client, enqueued, sent: enqueued, fields: this.trace } as any
+        if (this.rtt >= 0) _trace.rtt = this.rtt // like PostJson: the previous post's send-response time
+        const batch = { ...this.pending, _trace }
+        this.pending = {}
+        this.trace = {}
+        this.urgentPending = false
+        this.posting = true
+        try {
+            const transit = Math.random() * MAX_NETWORK_MS
+            await sleep(transit)
+            const body = JSON.stringify(batch)
+            const res = await fetch(this.base, { method: "POST", headers: { "Content-Type": "application/json" }, body })
+            await res.text()
+            await sleep(transit)
+            this.rtt = Math.round(this.now() - enqueued)
+        } catch (e) {
+            console.error(`${this.client}: post failed`, e)
+        }
+        this.posting = false
+    }
+
+    async run(end: number) {
+        await sleep(Math.random() * 1000) // EuroScope instances tick out of phase
+        const timer = setInterval(() => this.tick(), 1000)
+        while (Date.now() < end) {
+            await sleep(-Math.log(1 - Math.random()) * (60000 / CAPTURES_PER_MINUTE))
+            const callsign = `SIM${Math.floor(Math.random() * 100)}`
+            if (Math.random() < URGENT_SHARE / 2) this.capture(callsign, "clearence", Math.random() < 0.5)
+            else if (Math.random() < URGENT_SHARE) this.capture(callsign, "groundstate", statuses[this.seq % statuses.length])
+            else this.capture(callsign, "squawk", String(1000 + Math.floor(Math.random() * 6777)))
+        }
+        await sleep(16000) // let the last regular post go out
+        clearInterval(timer)
+    }
+}
+
+async function main() {
+    process.env.ESDATA_DIR = ""
+    process.env.ESDATA_RATE_LIMIT_BURST = "1000" // all simulated plugins post from the same address
+    process.env.ESDATA_RATE_LIMIT_PER_SEC = "1000"
+    const { default: esdataRoutes } = await import("../../routes/esdata")
+    const app = express()
+    app.use(bodyparser.json())
+    app.use("/esdata", esdataRoutes)
+    const listener = app.listen(0)
+    await new Promise((resolve) => listener.once("listening", resolve))
+    const address = listener.address()
+    const base = `http://localhost:${typeof address == "object" && address ? address.port : 0}/esdata`
+
+    console.log(
+        `${PLUGINS} plugins for ${DURATION_S} s, network up to ${MAX_NETWORK_MS} ms each way, clocks off by up to ${MAX_SKEW_MS} ms`,
+    )
+    await fetch(`${base}/debug/latency?reset=1`)
+    const end = Date.now() + DURATION_S * 1000
+    await Promise.all(Array.from({ length: PLUGINS }, (_, n) => new SimulatedPlugin(`SIM_${n}_TWR`, base).run(end)))
+
+    const report = await (await fetch(`${base}/debug/latency`)).json()
+    const stages = [
+        "plugin capture-enqueue",
+        "network rtt/2",
+        "backend receive-merge",
+        "end-to-end groundstate",
+        "cross-clock network send-receive",
+        "cross-clock end-to-end",
+    ]
+    for (const stage of stages) {
+        const { count, p50, p90, p99, max } = report.stages[stage] || {}
+        console.log(`${stage.padEnd(32)} n=${count} p50<=${p50} p90<=${p90} p99<=${p99} max=${max} ms`)
+    }
+    const slo = report.slo
+    console.log(`SLO ${slo.stage} p${slo.percentile} <= ${slo.ms} ms: n=${slo.count} actual ${slo.actual} ms ${slo.ok ? "OK" : "FAILED"}`)
+    process.exit(slo.ok ? 0 : 1)
+}
+
+main().catch(console.error)
@@ -0,0 +1,167 @@
+import express from "express"
+import bodyparser from "body-parser"
+import { fork, type ChildProcess } from "child_process"
+import fs from "fs"
+import os from "os"
+import path from "path"
+
+// Load generator for POST /esdata. Hundreds of simulated controllers post overlapping callsigns,
+// like the plugin's updateall after connecting, at a compressed cadence. The esdata routes run in a
+// child process (with persistence to a temp directory) once merging each batch directly and once
+// with the ingest buffer, and the event loop delay and POST latency of both runs are compared. A
+// third run adds pollers that GET /esdata like the plugin's downlink (?since= and If-None-Match
+// every 5 s), to see what conditional GETs cost next to the posts.
+//
+//   npx tsx src/esdata/scripts/load-generator.ts [controllers] [callsigns] [interval ms] [seconds] [pollers]
+
+const CONTROLLERS = parseInt(process.argv[2] || "300", 10)
+const CALLSIGNS = parseInt(process.argv[3] || "150", 10)
+const INTERVAL_MS = parseInt(process.argv[4] || "1000", 10)
+const DURATION_S = parseInt(process.argv[5] || "15", 10)
+const POLLERS = parseInt(process.argv[6] || "300", 10)
+const POLL_INTERVAL_MS = 5000 // DOWNLINK_INTERVAL_MS in the plugin
+const statuses = ["ONFREQ", "DE-ICE", "STUP", "PUSH", "TAXI", "LINEUP", "DEPA"]
+
+async function server() {
+    const { default: esdataRoutes } = await import("../../routes/esdata")
+    const app = express()
+    app.use(bodyparser.json({ limit: "5mb" }))
+    app.use("/esdata", esdataRoutes)
+    const listener = app.listen(0, () => {
+        const address = listener.address()
+        process.send!(typeof address == "object" && address ? address.port : 0)
+    })
+}
+
+function sampleBatch(controller: number, tick: number) {
+    const now = Date.now()
+    const batch = {} as { [key: string]: any }
+    const fields = {} as { [callsign: string]: any }
+    for (let i = 0; i < CALLSIGNS; i++) {
+        const callsign = `LG${i}`
+        batch[callsign] = {
+            controller: `ESSA_${controller}_TWR`,
+            squawk: String(1000 + ((i + tick) % 6777)),
+            rfl: 30000 + (i % 10) * 1000,
+            sid: "LAKE1A",
+            depRwy: "01L",
+            groundstate: statuses[(i + tick) % statuses.length],
+            clearence: (i + tick) % 2 == 0,
+            stand: `F${i % 60}`,
+        }
+        fields[callsign] = { groundstate: [now, tick + 1] }
+    }
+    batch._trace = { client: `LG-${controller}`, enqueued: now, sent: now, fields }
+    return JSON.stringify(batch)
+}
+
+function startServer(mode: string, env: { [key: string]: string }): Promise<{ child: ChildProcess; port: number; dir: string }> {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), `esdata-load-${mode}-`))
+    const child = fork(__filename, ["--server"], { env: { ...process.env, ...env, ESDATA_DIR: dir }, execArgv: process.execArgv })
+    return new Promise((resolve, reject) => {
+        child.once("message", (port) => resolve({ child, port: port as number, dir }))
+        child.once("exit", (code) => reject(new Error(`server exited with ${code}`)))
+    })
+}
+
+function percentile(values: number[], p: number) {
+    return values[Math.min(values.length - 1, Math.floor((p / 100) * values.length))] || 0
+}
+
+async function run(mode: string, env: { [key: string]: string }, pollers = 0) {
+    const { child, port, dir } = await startServer(mode, env)
+    const base = `http://localhost:${port}/esdata`
+    await fetch(`${base}/debug/ingest?reset=1`)
+
+    const latencies = [] as number[]
+    let rejected = 0
+    let failed = 0
+    const end = Date.now() + DURATION_S * 1000
+    const controller = async (n: number) => {
+        await new Promise((resolve) => setTimeout(resolve, Math.random() * INTERVAL_MS)) // spread them out
+        for (let tick = 0; Date.now() < end; tick++) {
+            const started = Date.now()
+            const body = sampleBatch(n, tick)
+            try {
+                const res = await fetch(base, { method: "POST", headers: { "Content-Type": "application/json" }, body })
+                await res.text()
+                if (res.status == 429) rejected++
+                else if (!res.ok) failed++
+            } catch (e) {
+                failed++
+            }
+            latencies.push(Date.now() - started)
+            await new Promise((resolve) => setTimeout(resolve, Math.max(0, INTERVAL_MS - (Date.now() - started))))
+        }
+    }
+    const polls = [] as number[]
+    let notModified = 0
+    let pollFailed = 0
+    const poller = async () => {
+        let version = ""
+        let etag = ""
+        await new Promise((resolve) => setTimeout(resolve, Math.random() * POLL_INTERVAL_MS))
+        while (Date.now() < end) {
+            const started = Date.now()
+            try {
+                const res = await fetch(version ? `${base}?since=${version}` : base, { headers: etag ? { "If-None-Match": etag } : {} })
+                if (res.status == 304) {
+                    notModified++
+                } else if (res.ok) {
+                    const body = await res.json()
+                    if (body.version) version = body.version
+                    etag = res.headers.get("ETag") || ""
+                } else {
+                    pollFailed++
+                }
+            } catch (e) {
+                pollFailed++
+            }
+            polls.push(Date.now() - started)
+            await new Promise((resolve) => setTimeout(resolve, Math.max(0, POLL_INTERVAL_MS - (Date.now() - started))))
+        }
+    }
+    await Promise.all([
+        ...Array.from({ length: CONTROLLERS }, (_, n) => controller(n)),
+        ...Array.from({ length: pollers }, () => poller()),
+    ])
+
+    const ingest = await (await fetch(`${base}/debug/ingest`)).json()
+    const latency = await (await fetch(`${base}/debug/latency`)).json()
+    child.kill()
+    fs.rmSync(dir, { recursive: true, force: true })
+
+    latencies.sort((a, b) => a - b)
+    const loop = ingest.eventLoopDelayMs
+    const merge = latency.stages["backend receive-merge"]
+    console.log(
+        `${mode.padEnd(8)} ${latencies.length} posts (${rejected} rate limited, ${failed} failed), ` +
+            `${ingest.flushes} merges, ${ingest.coalescedWrites} coalesced writes`,
+    )
+    console.log(
+        `${"".padEnd(8)} event loop delay p50 ${loop.p50.toFixed(1)} p99 ${loop.p99.toFixed(1)} max ${loop.max.toFixed(1)} ms, ` +
+            `POST p50 ${percentile(latencies, 50)} p99 ${percentile(latencies, 99)} ms, receive-merge p99 <= ${merge?.p99 ?? 0} ms`,
+    )
+    if (pollers) {
+        polls.sort((a, b) => a - b)
+        console.log(
+            `${"".padEnd(8)} ${polls.length} polls (${notModified} not modified, ${pollFailed} failed), ` +
+                `GET p50 ${percentile(polls, 50)} p99 ${percentile(polls, 99)} ms`,
+        )
+    }
+}
+
+async function main() {
+    console.log(
+        `${CONTROLLERS} controllers posting ${CALLSIGNS} callsigns every ${INTERVAL_MS} ms for ${DURATION_S} s, ${POLLERS} pollers every ${POLL_INTERVAL_MS} ms`,
+    )
+    // All simulated controllers post from the same address, so the per-address rate limit is raised
+    const limits = { ESDATA_RATE_LIMIT_BURST: "1000", ESDATA_RATE_LIMIT_PER_SEC: "1000" }
+    await run("direct", { ...limits, ESDATA_INGEST_WINDOW_MS: "0" })
+    const buffered = { ...limits, ESDATA_INGEST_WINDOW_MS: process.env.ESDATA_INGEST_WINDOW_MS || "100" }
+    await run("buffered", buffered)
+    if (POLLERS) await run("polling", buffered, POLLERS)
+}
+
+if (process.argv.includes("--server")) server().catch(console.error)
+else main().catch(console.error)
@@ -0,0 +1,45 @@
+import express from "express"
+import bodyparser from "body-parser"
+
+// Local stand-in for backend.vatiris.se/esdata, for testing the EuroScope plugin downlink cache.
+// Serves the real esdata routes (in memory only) and keeps changing stands and ground states of a
+// set of fake callsigns. Point the plugin at it with a "backend http://localhost:5199" line in
+// VatIRISPlugin.txt and add the VatIRIS tag items to a list or tag.
+//
+//   npx tsx src/esdata/scripts/stub-server.ts [port] [callsigns]
+
+const port = parseInt(process.argv[2] || "5199", 10)
+const callsignCount = parseInt(process.argv[3] || "200", 10)
+const statuses = ["ONFREQ", "DE-ICE", "STUP", "PUSH", "TAXI", "LINEUP", "DEPA"]
+const base = `http://localhost:${port}/esdata`
+
+async function selfCheck() {
+    const first = await fetch(base)
+    const etag = first.headers.get("etag") || ""
+    const notModified = await fetch(base, { headers: { "If-None-Match": etag } })
+    const delta = await fetch(`${base}?since=${etag.replace(/"/g, "")}`, { headers: { "If-None-Match": etag } })
+    console.log(`etag ${etag}, conditional GET → ${notModified.status}, since → ${delta.status}`)
+}
+
+async function main() {
+    process.env.ESDATA_DIR = ""
+    const { default: esdataRoutes } = await import("../../routes/esdata")
+
+    const app = express()
+    app.use(bodyparser.json())
+    app.use("/esdata", esdataRoutes)
+    app.listen(port, () => console.log(`esdata stub server at ${base} with ${callsignCount} callsigns`))
+
+    let tick = 0
+    setInterval(async () => {
+        const batch = {} as { [key: string]: any }
+        for (let i = 0; i < callsignCount; i++) {
+            if ((i + tick) % 10 != 0) continue // a tenth of the traffic changes per tick
+            batch[`STB${i}`] = { stand: `F${(i + tick) % 60}`, groundstate: statuses[(i + tick) % statuses.length] }
+        }
+        await fetch(base, { method: "POST", headers: { "Content-Type": "application/json" }, body: JSON.stringify(batch) })
+        if (tick++ == 0) await selfCheck()
+    }, 2000)
+}
+
+main().catch(console.error)
@@ -0,0 +1,36 @@
+import assert from "assert"
+import { applyUpdate, changesSince, currentVersion, markChanged, markRemoved, type EsdataEntries } from "./store"
+
+const entries: EsdataEntries = {}
+function post(key: string, update: any) {
+    applyUpdate(entries, key, update, "2026-05-23T10:00:00.000Z")
+    markChanged(key)
+}
+
+post("SAS123", { stand: "F32" })
+post("NAX456", { stand: "F34" })
+const v1 = currentVersion()
+
+const unchanged = changesSince(entries, v1)
+assert.strictEqual(unchanged.full, false)
+assert.strictEqual(unchanged.version, v1)
+assert.deepStrictEqual(unchanged.changed, {})
+assert.deepStrictEqual(unchanged.removed, [])
+
+post("SAS123", { groundstate: "PUSH" })
+delete entries.NAX456
+markRemoved("NAX456")
+const delta = changesSince(entries, v1)
+assert.strictEqual(delta.full, false)
+assert.notStrictEqual(delta.version, v1)
+assert.deepStrictEqual(Object.keys(delta.changed), ["SAS123"])
+assert.strictEqual(delta.changed.SAS123.groundstate, "PUSH")
+assert.deepStrictEqual(delta.removed, ["NAX456"])
+
+// Versions from another server instance (e.g. before a restart) give a full response
+for (const since of ["", "0", "abc.1", `${v1.split(".")[0]}.999999`]) {
+    const full = changesSince(entries, since)
+    assert.strictEqual(full.full, true)
+    assert.deepStrictEqual(full.changed, entries)
+    assert.deepStrictEqual(full.removed, [])
+}
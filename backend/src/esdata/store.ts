@@ -0,0 +1,79 @@
+import moment from "moment"
+
+export type EsdataEntries = { [key: string]: any }
+
+// Kept in memory, with ./persistence writing a snapshot + log to survive restarts
+export const euroscopeData: EsdataEntries = {}
+
+const MAX_AGE_HOURS = 6
+
+export function applyUpdate(entries: EsdataEntries, key: string, update: any, timestamp: string, writes = 1) {
+    if (!(key in entries)) entries[key] = {}
+    const data = entries[key]
+    Object.assign(data, update)
+    if (!("count" in data)) data.count = 0
+    data.count += writes
+    data.timestamp = timestamp
+    return data
+}
+
+export function removeStale(entries: EsdataEntries) {
+    const now = moment()
+    const removed = [] as string[]
+    for (const key in entries) {
+        const data = entries[key]
+        if (data.timestamp && now.diff(moment(data.timestamp), "hours") > MAX_AGE_HOURS) {
+            delete entries[key]
+            removed.push(key)
+        }
+    }
+    return removed
+}
+
+// Change versions for conditional GET (ETag / ?since=) - the epoch makes versions from before a
+// restart invalid, and clients holding one get a full response instead.
+const MAX_TOMBSTONES = 10000
+const epoch = Date.now().toString(36)
+let version = 0
+let tombstoneFloor = 0
+const changedVersions = new Map<string, number>()
+const removedVersions = new Map<string, number>()
+
+export function currentVersion() {
+    return `${epoch}.${version}`
+}
+
+export function markChanged(key: string) {
+    version++
+    changedVersions.set(key, version)
+    removedVersions.delete(key)
+}
+
+export function markRemoved(key: string) {
+    version++
+    changedVersions.delete(key)
+    removedVersions.set(key, version)
+    if (removedVersions.size > MAX_TOMBSTONES) {
+        removedVersions.clear()
+        tombstoneFloor = version
+    }
+}
+
+export function changesSince(entries: EsdataEntries, since: string) {
+    const [sinceEpoch, sinceVersionString] = since.split(".")
+    const sinceVersion = parseInt(sinceVersionString, 10)
+    const full = sinceEpoch != epoch || isNaN(sinceVersion) || sinceVersion < tombstoneFloor || sinceVersion > version
+    const changed: EsdataEntries = {}
+    const removed = [] as string[]
+    if (full) {
+        Object.assign(changed, entries)
+    } else {
+        for (const [key, keyVersion] of changedVersions) {
+            if (keyVersion > sinceVersion && key in entries) changed[key] = entries[key]
+        }
+        for (const [key, keyVersion] of removedVersions) {
+            if (keyVersion > sinceVersion) removed.push(key)
+        }
+    }
+    return { version: currentVersion(), full, changed, removed }
+}
@@ -2,27 +2,78 @@ import { Router, Request, Response } from "express"
 
 import auth from "../auth"
 import moment from "moment"
+import { applyUpdate, changesSince, currentVersion, euroscopeData, markChanged, markRemoved, removeStale } from "../esdata/store"
+import { EsdataPersistence } from "../esdata/persistence"
+import { latencyReport, resetLatency } from "../esdata/latency"
+import { allowRequest, flushIngest, ingestBatch, ingestReport, resetIngestStats, setIngestPersistence } from "../esdata/ingest"
 
 const esdata = Router()
 
-// just storing in memory for now...
-const euroscopeData: { [key: string]: any } = {}
+// Set ESDATA_DIR to an empty string to keep everything in memory only
+const esdataDir = process.env.ESDATA_DIR ?? "data/esdata"
+const persistence = esdataDir ? new EsdataPersistence(esdataDir, euroscopeData) : null
+if (persistence) {
+    try {
+        const restored = persistence.restore()
+        console.log(
+            `esdata: restored ${restored.entries} entries (${restored.snapshotEntries} from snapshot, ${restored.logRecords} log records, ${restored.skippedRecords} skipped) in ${restored.ms.toFixed(1)} ms`,
+        )
+        persistence.start()
+        setIngestPersistence(persistence)
+    } catch (e) {
+        console.error("esdata: failed to restore state", e)
+    }
+}
+
+// Entries not updated for hours are swept on a timer rather than on every GET, which pollers hit
+// every few seconds; removals are versioned and logged like a DELETE
+const STALE_SWEEP_INTERVAL_MS = (parseInt(process.env.ESDATA_STALE_SWEEP_INTERVAL_SEC || "60", 10) || 60) * 1000
+function sweepStale() {
+    const removed = removeStale(euroscopeData)
+    if (removed.length == 0) return
+    const timestamp = moment().utc().toISOString()
+    for (const key of removed) {
+        markRemoved(key)
+        persistence?.append({ t: timestamp, d: key })
+    }
+    console.log(`esdata: removed ${removed.length} stale entries`)
+}
+sweepStale()
+const staleSweepTimer = setInterval(sweepStale, STALE_SWEEP_INTERVAL_MS)
+staleSweepTimer.unref()
+
+// Behind a reverse proxy, req.ip is the client address only with "trust proxy" set (see server.ts)
+function rateLimited(req: Request, res: Response) {
+    if (allowRequest(req.ip || "")) return false
+    res.status(429).set("Retry-After", "1").send("rate limited")
+    return true
+}
+
+export function closeEsdata() {
+    clearInterval(staleSweepTimer)
+    flushIngest()
+    persistence?.close()
+}
 
 esdata.get("/", async (req: Request, res: Response) => {
+    // Conditional GET for pollers such as the EuroScope plugin: 304 if nothing changed, and with
+    // ?since=<version> only what changed after that version. Checked before anything else.
+    const etag = `"${currentVersion()}"`
+    res.setHeader("ETag", etag)
+    if (req.headers["if-none-match"] == etag) return res.status(304).end()
     // const cid = await auth.requireCid(req, res)
+    if (typeof req.query.since == "string") res.send(changesSince(euroscopeData, req.query.since))
+    else res.send(euroscopeData)
+})
 
-    // clean up old data
-    for (const key in euroscopeData) {
-        const data = euroscopeData[key]
-        if (data.timestamp) {
-            const timestamp = moment(data.timestamp)
-            if (moment().diff(timestamp, "hours") > 6) {
-                delete euroscopeData[key]
-            }
-        }
-    }
+esdata.get("/debug/latency", async (req: Request, res: Response) => {
+    if (req.query.reset) resetLatency()
+    res.send(latencyReport())
+})
 
-    res.send(euroscopeData)
+esdata.get("/debug/ingest", async (req: Request, res: Response) => {
+    if (req.query.reset) resetIngestStats()
+    res.send(ingestReport())
 })
 
 esdata.get("/:key", async (req: Request, res: Response) => {
@@ -36,31 +87,31 @@ esdata.get("/:key", async (req: Request, res: Response) => {
 
 esdata.post("/", async (req: Request, res: Response) => {
     // TODO some kind of auth but not oauth... could validate cid though
-    for (const key in req.body) {
-        if (!(key in euroscopeData)) euroscopeData[key] = {}
-        const data = euroscopeData[key]
-        Object.assign(data, req.body[key])
-        if (!("count" in data)) data.count = 0
-        data.count++
-        data.timestamp = moment().utc().toISOString()
-    }
+    const receivedAt = Date.now()
+    if (rateLimited(req, res)) return
+    const { _trace, ...batch } = req.body
+    ingestBatch(batch, _trace, receivedAt)
     res.send("ok")
 })
 
 esdata.post("/:key", async (req: Request, res: Response) => {
     // TODO some kind of auth but not oauth... could validate cid though
-    if (!(req.params.key in euroscopeData)) euroscopeData[req.params.key] = {}
-    const data = euroscopeData[req.params.key]
-    Object.assign(data, req.body)
-    if (!("count" in data)) data.count = 0
-    data.count++
-    data.timestamp = moment().utc().toISOString()
+    if (rateLimited(req, res)) return
+    flushIngest() // keep ordering with buffered batches
+    const timestamp = moment().utc().toISOString()
+    const data = applyUpdate(euroscopeData, req.params.key, req.body, timestamp)
+    markChanged(req.params.key)
+    persistence?.append({ t: timestamp, b: { [req.params.key]: req.body } })
     res.send(data)
 })
 
 esdata.delete("/:key", async (req: Request, res: Response) => {
     // TODO some kind of auth but not oauth... could validate cid though
+    if (rateLimited(req, res)) return
+    flushIngest()
     delete euroscopeData[req.params.key]
+    markRemoved(req.params.key)
+    persistence?.append({ t: moment().utc().toISOString(), d: req.params.key })
     res.send("ok")
 })
 
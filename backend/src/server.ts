@@ -13,6 +13,11 @@ const redirectUri = process.env.REDIRECT_URI || "http://localhost:5173/login"
 const app = express()
 const port = process.env.PORT || 5172
 
+// The backend runs behind a reverse proxy - trust its X-Forwarded-For so that req.ip is the client
+// address. TRUST_PROXY is a hop count or proxy addresses/subnets, e.g. "loopback" or "10.0.0.0/8".
+const trustProxy = process.env.TRUST_PROXY || "loopback"
+app.set("trust proxy", /^\d+$/.test(trustProxy) ? parseInt(trustProxy, 10) : trustProxy)
+
 app.use(cors())
 app.use(bodyparser.json())
 
@@ -70,7 +75,7 @@ app.use("/data", dataRoutes)
 import wikiRoutes from "./routes/wiki"
 app.use("/wiki", wikiRoutes)
 
-import esdataRoutes from "./routes/esdata"
+import esdataRoutes, { closeEsdata } from "./routes/esdata"
 app.use("/esdata", esdataRoutes)
 
 import eaipRoutes from "./routes/eaip"
@@ -90,3 +95,10 @@ app.use(express.static("public"))
 app.get(/.*/, (req, res) => {
     res.status(404).send()
 })
+
+for (const signal of ["SIGINT", "SIGTERM"]) {
+    process.on(signal, () => {
+        closeEsdata()
+        process.exit(0)
+    })
+}
@@ -9,5 +9,6 @@ cmake --build . --config Release
 
 if [ -d "$APPDATA/EuroScope/ESAA/Plugins" ]; then
     cp -f Release/VatIRIS.dll "$APPDATA/EuroScope/ESAA/Plugins/"
+    cp -f ../../frontend/src/data/stands.json "$APPDATA/EuroScope/ESAA/Plugins/VatIRISStands.json"
     echo "Copied DLL to $APPDATA/EuroScope/ESAA/Plugins"
 fi
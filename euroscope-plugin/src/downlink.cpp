@@ -0,0 +1,263 @@
+#include "downlink.h"
+#include <cstring>
+#include <wininet.h>
+
+#pragma comment(lib, "wininet.lib")
+
+namespace VatIRIS
+{
+
+const DWORD DOWNLINK_INTERVAL_MS = 5000;
+const DWORD DOWNLINK_TIMEOUT_MS = 3000;
+const DWORD DOWNLINK_STOP_WAIT_MS = 500; // on the EuroScope thread
+
+static void CopyTagString(char (&target)[16], const nlohmann::json &data, const char *key)
+{
+    auto it = data.find(key);
+    if (it == data.end() || !it->is_string()) return;
+    strncpy(target, it->get_ref<const std::string &>().c_str(), sizeof(target) - 1);
+    target[sizeof(target) - 1] = '\0';
+}
+
+DownlinkCache::DownlinkCache()
+: port(0), secure(true), thread(NULL), stopEvent(NULL), request(NULL), stopping(false),
+pending(nullptr)
+{
+}
+
+DownlinkCache::~DownlinkCache()
+{
+    Stop();
+    // The thread uses this object - with its request aborted it is about to exit, so wait for it
+    if (thread) WaitForSingleObject(thread, INFINITE);
+    if (thread) CloseHandle(thread);
+    if (stopEvent) CloseHandle(stopEvent);
+    delete pending.exchange(nullptr);
+}
+
+bool DownlinkCache::Start(const std::string &host, unsigned short port, bool secure)
+{
+    if (thread) {
+        if (!stopping) return true; // already running
+        // Stop() timed out - the previous thread still uses the fetch state, so retry later
+        if (WaitForSingleObject(thread, 0) == WAIT_TIMEOUT) return false;
+        CloseHandle(thread);
+        CloseHandle(stopEvent);
+        thread = NULL;
+        stopEvent = NULL;
+    }
+
+    this->host = host;
+    this->port = port;
+    this->secure = secure;
+    version.clear();
+    etag.clear();
+    entries.clear();
+    delete pending.exchange(nullptr); // anything the previous thread published late
+    stopping = false;
+    stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!stopEvent) return false;
+    thread = CreateThread(NULL, 0, FetchLoop, this, 0, NULL);
+    if (!thread) {
+        CloseHandle(stopEvent);
+        stopEvent = NULL;
+        return false;
+    }
+    return true;
+}
+
+void DownlinkCache::Stop()
+{
+    // Don't leave tags showing data that is no longer updated
+    current.reset();
+    if (!thread) return;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        stopping = true;
+        if (request) InternetCloseHandle(request);
+        request = NULL;
+    }
+    SetEvent(stopEvent);
+
+    // If the thread does not exit in time, keep its handles - Start() and the destructor wait
+    if (WaitForSingleObject(thread, DOWNLINK_STOP_WAIT_MS) != WAIT_OBJECT_0) return;
+    CloseHandle(thread);
+    CloseHandle(stopEvent);
+    thread = NULL;
+    stopEvent = NULL;
+}
+
+bool DownlinkCache::Swap()
+{
+    DownlinkSnapshot *latest = pending.exchange(nullptr);
+    if (!latest) return false;
+    current.reset(latest);
+    return true;
+}
+
+const DownlinkEntry *DownlinkCache::Find(const std::string &callsign) const
+{
+    if (!current) return nullptr;
+    auto it = current->entries.find(callsign);
+    return it == current->entries.end() ? nullptr : &it->second;
+}
+
+bool DownlinkCache::Apply(const nlohmann::json &response)
+{
+    if (!response.is_object()) return false;
+    bool changed = false;
+    if (response.value("full", false)) {
+        changed = true; // always publish, e.g. an empty store replacing a snapshot from before
+        entries.clear();
+    }
+
+    auto updated = response.find("changed");
+    if (updated != response.end() && updated->is_object()) {
+        for (auto &[callsign, data] : updated->items()) {
+            if (!data.is_object() || callsign.length() > 20) continue;
+            DownlinkEntry entry;
+            CopyTagString(entry.stand, data, "occupiedStand");
+            CopyTagString(entry.stand, data, "stand"); // assigned stand takes precedence
+            CopyTagString(entry.groundState, data, "groundstate");
+            if (!*entry.stand && !*entry.groundState) {
+                changed |= entries.erase(callsign) > 0; // e.g. controllers
+                continue;
+            }
+            entries[callsign] = entry;
+            changed = true;
+        }
+    }
+
+    auto removed = response.find("removed");
+    if (removed != response.end() && removed->is_array()) {
+        for (auto &callsign : *removed) {
+            if (callsign.is_string()) changed |= entries.erase(callsign.get<std::string>()) > 0;
+        }
+    }
+
+    version = response.value("version", "");
+    return changed;
+}
+
+std::unique_ptr<DownlinkSnapshot> DownlinkCache::BuildSnapshot() const
+{
+    auto snapshot = std::make_unique<DownlinkSnapshot>();
+    snapshot->entries = entries;
+    return snapshot;
+}
+
+void DownlinkCache::Publish(std::unique_ptr<DownlinkSnapshot> snapshot)
+{
+    // A snapshot not yet picked up by Swap() is superseded and can be freed right away
+    delete pending.exchange(snapshot.release());
+}
+
+DWORD WINAPI DownlinkCache::FetchLoop(LPVOID lpParameter)
+{
+    DownlinkCache *cache = static_cast<DownlinkCache *>(lpParameter);
+    do {
+        try {
+            cache->Fetch();
+        } catch (...) {
+            // Keep the current snapshot and retry next interval
+        }
+    } while (WaitForSingleObject(cache->stopEvent, DOWNLINK_INTERVAL_MS) == WAIT_TIMEOUT);
+    return 0;
+}
+
+void DownlinkCache::Fetch()
+{
+    HINTERNET hInternet = InternetOpenA("VatIRIS downlink", INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0);
+    if (!hInternet) return;
+    DWORD timeout = DOWNLINK_TIMEOUT_MS;
+    InternetSetOptionA(hInternet, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionA(hInternet, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+    InternetSetOptionA(hInternet, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+
+    HINTERNET hConnect = InternetConnectA(hInternet, host.c_str(), port, NULL, NULL, INTERNET_SERVICE_HTTP, 0, 0);
+    if (!hConnect) {
+        InternetCloseHandle(hInternet);
+        return;
+    }
+
+    std::string path = "esdata?since=" + version;
+    const char *acceptTypes[] = { "application/json", NULL };
+    DWORD flags = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | (secure ? INTERNET_FLAG_SECURE : 0);
+    HINTERNET hRequest = HttpOpenRequestA(hConnect, "GET", path.c_str(), NULL, NULL, acceptTypes, flags, 0);
+    if (!hRequest) {
+        InternetCloseHandle(hConnect);
+        InternetCloseHandle(hInternet);
+        return;
+    }
+
+    bool started = BeginRequest(hRequest);
+    std::string headers;
+    if (!etag.empty()) headers = "If-None-Match: " + etag + "\r\n";
+    const char *headerData = headers.empty() ? NULL : headers.c_str();
+    if (started && HttpSendRequestA(hRequest, headerData, (DWORD)headers.length(), NULL, 0)) {
+        DWORD status = 0;
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            DWORD size = sizeof(status);
+            DWORD query = HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER;
+            if (request) HttpQueryInfoA(hRequest, query, &status, &size, NULL);
+        }
+        // 304 Not Modified - nothing to do, the current snapshot is still valid
+        if (status == 200) {
+            std::string body;
+            char buffer[8192];
+            DWORD read = 0;
+            // Stop() may close the handle during a read - that read fails and ends the loop
+            while (RequestActive() && InternetReadFile(hRequest, buffer, sizeof(buffer), &read) &&
+                   read > 0)
+                body.append(buffer, read);
+
+            char etagBuffer[128];
+            DWORD etagSize = sizeof(etagBuffer);
+            std::string newEtag;
+            bool complete = false;
+            {
+                std::lock_guard<std::mutex> lock(requestMutex);
+                complete = request != NULL;
+                if (complete &&
+                    HttpQueryInfoA(hRequest, HTTP_QUERY_ETAG, etagBuffer, &etagSize, NULL))
+                    newEtag.assign(etagBuffer, etagSize);
+            }
+
+            nlohmann::json response = nlohmann::json::parse(body, nullptr, false);
+            if (complete && !response.is_discarded()) {
+                if (Apply(response)) Publish(BuildSnapshot());
+                etag = newEtag;
+            }
+        }
+    }
+
+    // Unless Stop() took and closed it
+    if (!started || EndRequest()) InternetCloseHandle(hRequest);
+    InternetCloseHandle(hConnect);
+    InternetCloseHandle(hInternet);
+}
+
+bool DownlinkCache::BeginRequest(HINTERNET hRequest)
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+    if (stopping) return false;
+    request = hRequest;
+    return true;
+}
+
+bool DownlinkCache::RequestActive()
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+    return request != NULL;
+}
+
+bool DownlinkCache::EndRequest()
+{
+    std::lock_guard<std::mutex> lock(requestMutex);
+    bool owned = request != NULL;
+    request = NULL;
+    return owned;
+}
+
+} // namespace VatIRIS
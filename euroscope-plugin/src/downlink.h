@@ -0,0 +1,81 @@
+#pragma once
+
+#include "json.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <windows.h>
+#include <wininet.h>
+
+namespace VatIRIS
+{
+
+const int TAG_ITEM_VATIRIS_STAND = 1;
+const int TAG_ITEM_VATIRIS_GROUND_STATE = 2;
+
+// Tag item strings, formatted when a snapshot is built so that drawing only copies them
+struct DownlinkEntry {
+    char stand[16] = "";
+    char groundState[16] = "";
+};
+
+struct DownlinkSnapshot {
+    std::unordered_map<std::string, DownlinkEntry> entries;
+};
+
+// VatIRIS data fetched from /esdata by a background thread using conditional GETs (ETag and
+// ?since=). Each change builds a new immutable snapshot which is handed over to the EuroScope
+// thread with an atomic pointer exchange, so tag item drawing reads it without any locking.
+class DownlinkCache
+{
+    public:
+    DownlinkCache();
+    ~DownlinkCache();
+
+    // Returns false while the previous fetch thread has not exited yet - call again later
+    bool Start(const std::string &host, unsigned short port, bool secure);
+    // Aborts any request in flight, clears the snapshot and waits briefly for the fetch thread
+    void Stop();
+
+    // EuroScope thread: adopt the latest snapshot from the fetch thread, if any
+    bool Swap();
+    // EuroScope thread: entry in the current snapshot, or nullptr
+    const DownlinkEntry *Find(const std::string &callsign) const;
+
+    // Fetch thread: apply a /esdata?since= response, returns true if anything changed
+    bool Apply(const nlohmann::json &response);
+    std::unique_ptr<DownlinkSnapshot> BuildSnapshot() const;
+    void Publish(std::unique_ptr<DownlinkSnapshot> snapshot);
+
+    private:
+    static DWORD WINAPI FetchLoop(LPVOID lpParameter);
+    void Fetch();
+    bool BeginRequest(HINTERNET request);
+    bool RequestActive();
+    bool EndRequest();
+
+    std::string host;
+    unsigned short port;
+    bool secure;
+    HANDLE thread, stopEvent;
+
+    // Closing the request handle from Stop() aborts the request in flight, including name lookups
+    // which the WinInet timeouts do not cover. Whoever takes it out of here closes it, and the
+    // fetch thread only uses it while it is still here.
+    std::mutex requestMutex;
+    HINTERNET request;
+    bool stopping;
+
+    // Fetch thread only
+    std::string version, etag;
+    std::unordered_map<std::string, DownlinkEntry> entries;
+
+    std::atomic<DownlinkSnapshot *> pending;
+
+    // EuroScope thread only
+    std::unique_ptr<DownlinkSnapshot> current;
+};
+
+} // namespace VatIRIS
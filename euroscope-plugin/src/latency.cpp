@@ -0,0 +1,72 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace VatIRIS
+{
+
+LatencyStats latencyStats;
+
+const int64_t LatencyHistogram::BUCKET_LIMITS_MS[BUCKETS - 1] = {
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 15000, 20000, 30000, 60000, 120000
+};
+
+int64_t NowMs()
+{
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+void LatencyHistogram::Record(int64_t ms)
+{
+    if (ms < 0) ms = 0; // clock skew
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && ms > BUCKET_LIMITS_MS[bucket])
+        bucket++;
+    counts[bucket]++;
+    count++;
+    if (ms > max) max = ms;
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const
+{
+    if (count == 0) return 0;
+    uint64_t target = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (target < 1) target = 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS - 1; bucket++) {
+        seen += counts[bucket];
+        if (seen >= target) return std::min(BUCKET_LIMITS_MS[bucket], max);
+    }
+    return max;
+}
+
+void LatencyStats::Record(const std::string &stage, int64_t ms)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stages[stage].Record(ms);
+}
+
+std::vector<std::string> LatencyStats::Report() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> lines;
+    for (auto &[stage, histogram] : stages) {
+        std::stringstream out;
+        out << stage << " n=" << histogram.Count() << " p50<=" << histogram.Percentile(50)
+            << " p90<=" << histogram.Percentile(90) << " p99<=" << histogram.Percentile(99)
+            << " max=" << histogram.Max() << " ms";
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+void LatencyStats::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stages.clear();
+}
+
+} // namespace VatIRIS
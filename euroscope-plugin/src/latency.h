@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VatIRIS
+{
+
+// Wall clock milliseconds - comparable with the backend, give or take clock skew
+int64_t NowMs();
+
+// Fixed bucket latency histogram, same buckets as the backend (backend/src/esdata/latency.ts)
+class LatencyHistogram
+{
+    public:
+    void Record(int64_t ms);
+    int64_t Percentile(double percentile) const;
+    uint64_t Count() const { return count; }
+    int64_t Max() const { return max; }
+
+    static const int BUCKETS = 16;
+    static const int64_t BUCKET_LIMITS_MS[BUCKETS - 1];
+
+    private:
+    uint64_t counts[BUCKETS] = {};
+    uint64_t count = 0;
+    int64_t max = 0;
+};
+
+// Histograms per pipeline stage, written by the EuroScope and post threads
+class LatencyStats
+{
+    public:
+    void Record(const std::string &stage, int64_t ms);
+    std::vector<std::string> Report() const;
+    void Clear();
+
+    private:
+    mutable std::mutex mutex;
+    std::map<std::string, LatencyHistogram> stages;
+};
+
+extern LatencyStats latencyStats;
+
+} // namespace VatIRIS
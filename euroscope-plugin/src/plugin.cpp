@@ -1,5 +1,6 @@
 #include "plugin.h"
 #include "Version.h"
+#include "latency.h"
 #include "postjson.h"
 
 #include "json.hpp"
@@ -19,6 +20,14 @@ namespace VatIRIS
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 char DllPathFile[_MAX_PATH];
 
+const std::time_t STAND_TRACK_TIMEOUT_S = 60; // radar targets update every 5 s or so
+
+// Fields posted within a second or so instead of waiting for the next regular post
+static bool IsUrgentField(const char *field)
+{
+    return strcmp(field, "clearence") == 0 || strcmp(field, "groundstate") == 0;
+}
+
 
 VatIRISPlugin::VatIRISPlugin()
 : CPlugIn(EuroScopePlugIn::COMPATIBILITY_CODE, PLUGIN_NAME, PLUGIN_VERSION, PLUGIN_AUTHOR, PLUGIN_LICENSE)
@@ -27,12 +36,15 @@ VatIRISPlugin::VatIRISPlugin()
     disabled = true; // ... until connected - see OnTimer
     updateAll = false;
     debug = false;
+    urgentPending = false;
+    traceSeq = 0;
+    SetBackend("https://backend.vatiris.se");
     mutex = CreateMutex(NULL, FALSE, NULL);
 
     GetModuleFileNameA(HINSTANCE(&__ImageBase), DllPathFile, sizeof(DllPathFile));
-    std::string settingsPath = DllPathFile;
-    settingsPath.resize(settingsPath.size() - strlen("VatIRIS.dll"));
-    settingsPath += "VatIRISPlugin.txt";
+    std::string pluginDir = DllPathFile;
+    pluginDir.resize(pluginDir.size() - strlen("VatIRIS.dll"));
+    std::string settingsPath = pluginDir + "VatIRISPlugin.txt";
     std::ifstream settingsFile(settingsPath);
     if (settingsFile.is_open()) {
         std::string line;
@@ -44,18 +56,31 @@ VatIRISPlugin::VatIRISPlugin()
                 debug = true;
             else if (line == "updateall")
                 updateAll = true;
+            else if (line.rfind("backend ", 0) == 0)
+                SetBackend(line.substr(8));
             else
                 DisplayMessage("Unknown setting: " + line);
         }
     }
     DebugMessage("Version " + std::string(PLUGIN_VERSION) + (updateAll ? " updateAll" : ""));
+
+    try {
+        size_t standCount = standIndex.LoadFile(pluginDir + "VatIRISStands.json");
+        DebugMessage("Loaded " + std::to_string(standCount) + " stands");
+    } catch (const std::exception &e) {
+        DisplayMessage(std::string("Failed to load stands: ") + e.what());
+    }
+
+    RegisterTagItemType("VatIRIS stand", TAG_ITEM_VATIRIS_STAND);
+    RegisterTagItemType("VatIRIS ground state", TAG_ITEM_VATIRIS_GROUND_STATE);
 }
 
 VatIRISPlugin::~VatIRISPlugin()
 {
+    downlink.Stop();
     if (mutex) {
         WaitForSingleObject(mutex, INFINITE); // Wait for any ongoing operations
-        pendingUpdates.clear(); // Clear any pending updates
+        ClearPending(); // Clear any pending updates
         ReleaseMutex(mutex);
         CloseHandle(mutex);
         mutex = NULL;
@@ -129,7 +154,7 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
 
         const char *controllerCallsign = FlightPlan.GetTrackingControllerCallsign();
         if (controllerCallsign && strlen(controllerCallsign) > 0 && strlen(controllerCallsign) < 20) {
-            pendingUpdates[callsign]["controller"] = controllerCallsign;
+            SetPending(callsign, "controller", controllerCallsign);
         }
 
         const EuroScopePlugIn::CFlightPlanControllerAssignedData ctrData = FlightPlan.GetControllerAssignedData();
@@ -144,7 +169,7 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             const char* squawk = ctrData.GetSquawk();
             if (squawk && strlen(squawk) == 4) { // Valid squawk is always 4 digits
                 out << " squawk " << squawk;
-                pendingUpdates[callsign]["squawk"] = squawk;
+                SetPending(callsign, "squawk", squawk);
             }
             break;
         }
@@ -152,20 +177,20 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             int rfl = ctrData.GetFinalAltitude();
             if (rfl >= 0 && rfl <= 100000) { // Reasonable altitude range
                 out << " rfl " << rfl;
-                pendingUpdates[callsign]["rfl"] = rfl;
+                SetPending(callsign, "rfl", rfl);
             }
             break;
         }
         case EuroScopePlugIn::CTR_DATA_TYPE_TEMPORARY_ALTITUDE: {
             int cfl = ctrData.GetClearedAltitude();
             out << " cfl " << cfl;
-            pendingUpdates[callsign]["cfl"] = cfl;
+            SetPending(callsign, "cfl", cfl);
             // 0 - no cleared level (use the final instead of)
             // 1 - cleared for ILS approach
             // 2 - cleared for visual approach
             if (cfl == 1 || cfl == 2) {
-                pendingUpdates[callsign]["ahdg"] = 0;
-                pendingUpdates[callsign]["direct"] = "";
+                SetPending(callsign, "ahdg", 0);
+                SetPending(callsign, "direct", "");
             }
             break;
         }
@@ -187,10 +212,10 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             
             // Safe string comparisons
             if (scratch == "LINEUP" || scratch == "ONFREQ" || scratch == "DE-ICE") {
-                pendingUpdates[callsign]["groundstate"] = scratch;
+                SetPending(callsign, "groundstate", scratch);
             } else if (scratch.length() > 6 && scratch.find("GRP/S/") != std::string::npos) {
                 // Ensure we have enough characters for substr(6)
-                pendingUpdates[callsign]["stand"] = scratch.substr(6);
+                SetPending(callsign, "stand", scratch.substr(6));
             }
             // Scratch pad inputs noticed in the wild (if we ever want to
             // reverse-engineer/understand some TopSky plugin features): /PRESHDG/ /ASP=/ /ASP+/
@@ -225,11 +250,11 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
         }
         case EuroScopePlugIn::CTR_DATA_TYPE_GROUND_STATE:
             out << " groundstate " << FlightPlan.GetGroundState();
-            pendingUpdates[callsign]["groundstate"] = FlightPlan.GetGroundState();
+            SetPending(callsign, "groundstate", FlightPlan.GetGroundState());
             break;
         case EuroScopePlugIn::CTR_DATA_TYPE_CLEARENCE_FLAG:
             out << " clearance " << FlightPlan.GetClearenceFlag();
-            pendingUpdates[callsign]["clearence"] = (bool)FlightPlan.GetClearenceFlag();
+            SetPending(callsign, "clearence", (bool)FlightPlan.GetClearenceFlag());
             break;
         case EuroScopePlugIn::CTR_DATA_TYPE_DEPARTURE_SEQUENCE:
             out << " dsq"; // TODO where dis dsq?
@@ -238,7 +263,7 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             int speed = ctrData.GetAssignedSpeed();
             if (speed >= 0 && speed <= 1500) { // Reasonable speed range
                 out << " asp " << speed;
-                pendingUpdates[callsign]["asp"] = speed;
+                SetPending(callsign, "asp", speed);
             }
             break;
         }
@@ -246,7 +271,7 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             double mach = ctrData.GetAssignedMach();
             if (mach >= 0.0 && mach <= 10.0) { // Reasonable mach range
                 out << " mach " << mach;
-                pendingUpdates[callsign]["mach"] = mach;
+                SetPending(callsign, "mach", mach);
             }
             break;
         }
@@ -254,7 +279,7 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             int rate = ctrData.GetAssignedRate();
             if (rate >= -50000 && rate <= 50000) { // Reasonable rate range
                 out << " arc " << rate;
-                pendingUpdates[callsign]["arc"] = rate;
+                SetPending(callsign, "arc", rate);
             }
             break;
         }
@@ -262,8 +287,8 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             int heading = ctrData.GetAssignedHeading();
             if (heading >= 0 && heading <= 360) { // Valid heading range
                 out << " ahdg " << heading;
-                pendingUpdates[callsign]["ahdg"] = heading;
-                pendingUpdates[callsign]["direct"] = "";
+                SetPending(callsign, "ahdg", heading);
+                SetPending(callsign, "direct", "");
             }
             break;
         }
@@ -271,8 +296,8 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
             const char* directTo = ctrData.GetDirectToPointName();
             if (directTo && strlen(directTo) > 0 && strlen(directTo) < 50) { // Reasonable waypoint name length
                 out << " direct " << directTo;
-                pendingUpdates[callsign]["direct"] = directTo;
-                pendingUpdates[callsign]["ahdg"] = 0;
+                SetPending(callsign, "direct", directTo);
+                SetPending(callsign, "ahdg", 0);
             }
             break;
         }
@@ -294,6 +319,11 @@ void VatIRISPlugin::OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CF
 
 void VatIRISPlugin::OnFlightPlanDisconnect(EuroScopePlugIn::CFlightPlan FlightPlan)
 {
+    // While disconnected, nothing is posted - and a vacated update queued now would only refresh
+    // the backend entry of an aircraft that is gone
+    std::string callsign = FlightPlan.GetCallsign();
+    if (!disabled && standOccupancy.IsPublished(callsign)) PublishStand(callsign, nullptr);
+    standOccupancy.Remove(callsign);
     if (disabled || !FilterFlightPlan(FlightPlan)) return;
     // TODO remove not really useful
     // std::stringstream out;
@@ -301,6 +331,74 @@ void VatIRISPlugin::OnFlightPlanDisconnect(EuroScopePlugIn::CFlightPlan FlightPl
     // DebugMessage(out.str());
 }
 
+void VatIRISPlugin::OnRadarTargetPositionUpdate(EuroScopePlugIn::CRadarTarget RadarTarget)
+{
+    try {
+        if (disabled || standIndex.Size() == 0 || !RadarTarget.IsValid()) return;
+
+        std::string callsign = RadarTarget.GetCallsign();
+        if (callsign.empty() || callsign.length() > 20) return;
+
+        // Only parked (or pushing) aircraft occupy a stand - anything faster is taxiing or airborne
+        EuroScopePlugIn::CRadarTargetPositionData position = RadarTarget.GetPosition();
+        const Stand *stand = nullptr;
+        if (position.IsValid() && position.GetReportedGS() <= 5) {
+            EuroScopePlugIn::CPosition pos = position.GetPosition();
+            stand = standIndex.Find(pos.m_Latitude, pos.m_Longitude);
+        }
+        if (!stand && !standOccupancy.IsTracked(callsign)) return;
+        if (!FilterFlightPlan(RadarTarget.GetCorrelatedFlightPlan())) return;
+
+        if (standOccupancy.Update(callsign, stand, std::time(NULL)))
+            PublishStand(callsign, standOccupancy.Get(callsign));
+    } catch (const std::exception &e) {
+        DisplayMessage(std::string("OnRadarTargetPositionUpdate exception: ") + e.what());
+    } catch (...) {
+        DisplayMessage("OnRadarTargetPositionUpdate: Unknown exception");
+    }
+}
+
+void VatIRISPlugin::PublishStand(const std::string &callsign, const Stand *stand)
+{
+    // Stand names are only unique per airport, hence the airport alongside
+    std::string name = stand ? stand->airport + " " + stand->name : "vacated";
+    DebugMessage("Stand " + callsign + " " + name);
+    SetPending(callsign, "occupiedStand", stand ? stand->name : "");
+    SetPending(callsign, "occupiedStandAirport", stand ? stand->airport : "");
+    if (stand) standOccupancy.MarkPublished(callsign);
+}
+
+void VatIRISPlugin::ExpireStands()
+{
+    // Radar targets can disappear without a flight plan disconnect, e.g. when out of range
+    for (auto &callsign : standOccupancy.RemoveStale(std::time(NULL) - STAND_TRACK_TIMEOUT_S))
+        PublishStand(callsign, nullptr);
+}
+
+void VatIRISPlugin::OnGetTagItem(EuroScopePlugIn::CFlightPlan FlightPlan,
+                                 EuroScopePlugIn::CRadarTarget RadarTarget,
+                                 int ItemCode,
+                                 int TagData,
+                                 char sItemString[16],
+                                 int *pColorCode,
+                                 COLORREF *pRGB,
+                                 double *pFontSize)
+{
+    // Called for every tag item of every aircraft on every redraw - keep it to a lookup and a copy
+    if (!FlightPlan.IsValid()) return;
+    const DownlinkEntry *entry = downlink.Find(FlightPlan.GetCallsign());
+    if (!entry) return;
+
+    switch (ItemCode) {
+    case TAG_ITEM_VATIRIS_STAND:
+        strcpy(sItemString, entry->stand);
+        break;
+    case TAG_ITEM_VATIRIS_GROUND_STATE:
+        strcpy(sItemString, entry->groundState);
+        break;
+    }
+}
+
 bool VatIRISPlugin::OnCompileCommand(const char *commandLine)
 {
     if (strncmp(commandLine, ".vatiris all", 12) == 0) {
@@ -315,6 +413,16 @@ bool VatIRISPlugin::OnCompileCommand(const char *commandLine)
         DisplayMessage("Debug mode enabled");
         debug = true;
         return true;
+    } else if (strncmp(commandLine, ".vatiris latency reset", 22) == 0) {
+        latencyStats.Clear();
+        DisplayMessage("Latency statistics cleared");
+        return true;
+    } else if (strncmp(commandLine, ".vatiris latency", 16) == 0) {
+        std::vector<std::string> lines = latencyStats.Report();
+        if (lines.empty()) DisplayMessage("No latency statistics yet");
+        for (auto &line : lines)
+            DisplayMessage(line);
+        return true;
     } else if (strncmp(commandLine, ".vatiris test", 13) == 0) {
         std::stringstream out;
         out << "me " << ControllerMyself().GetCallsign();
@@ -337,16 +445,29 @@ void VatIRISPlugin::OnTimer(int counter)
             DebugMessage("VatIRIS updates enabled");
         } else if (!disabled && GetConnectionType() != EuroScopePlugIn::CONNECTION_TYPE_DIRECT) {
             disabled = true;
+            downlink.Stop();
+            standOccupancy.Clear(); // no position updates while disconnected, rebuilt on reconnect
             DebugMessage("VatIRIS updates disabled");
             return;
         } else if (disabled) {
             return;
         }
 
+        // No-op while running, and retried until a previous fetch thread has exited
+        downlink.Start(backendHost, backendPort, backendSecure);
+        if (downlink.Swap()) DebugMessage("VatIRIS data updated");
+
         if (std::time(NULL) - enabledTime < 10) return;
-        if (counter % 30 == 0) UpdateMyself();
-        if (pendingUpdates.empty()) return;
-        if (std::time(NULL) - lastPostTime < (5 + (std::rand() % 10))) return;
+        if (counter % 30 == 0) {
+            UpdateMyself();
+            ExpireStands();
+        }
+        if (pendingUpdates.empty() && !updatesRejected) return;
+        if (urgentPending) {
+            if (std::time(NULL) - lastPostTime < 1) return;
+        } else if (std::time(NULL) - lastPostTime < (5 + (std::rand() % 10))) {
+            return;
+        }
         PostUpdates();
     } catch (const std::exception &e) {
         DisplayMessage(std::string("OnTimer exception: ") + e.what());
@@ -361,7 +482,7 @@ void VatIRISPlugin::UpdateMyself()
         // Limit the size of controller updates
         if (pendingUpdates.size() > 1000) {
             DebugMessage("Too many pending updates in UpdateMyself");
-            pendingUpdates.clear();
+            ClearPending();
         }
 
         EuroScopePlugIn::CController me = ControllerMyself();
@@ -379,16 +500,16 @@ void VatIRISPlugin::UpdateMyself()
         // Validate and limit controller data
         const char *fullName = me.GetFullName();
         if (fullName && *fullName && strlen(fullName) < 50) {
-            pendingUpdates[callsign]["name"] = fullName;
+            SetPending(callsign, "name", fullName);
         }
 
         double frequency = me.GetPrimaryFrequency();
         if (frequency >= 100.0 && frequency <= 200.0) {
-            pendingUpdates[callsign]["frequency"] = frequency;
+            SetPending(callsign, "frequency", frequency);
         }
 
-        pendingUpdates[callsign]["controller"] = me.IsController();
-        pendingUpdates[callsign]["pluginVersion"] = PLUGIN_VERSION;
+        SetPending(callsign, "controller", me.IsController());
+        SetPending(callsign, "pluginVersion", PLUGIN_VERSION);
 
         // Limit the size of the rwyconfig structure
         nlohmann::json& rwyconfig = pendingUpdates[callsign]["rwyconfig"];
@@ -462,11 +583,11 @@ void VatIRISPlugin::UpdateMyself()
     } catch (const std::exception &e) {
         DisplayMessage(std::string("UpdateMyself exception: ") + e.what());
         // Clear updates on error to prevent corrupted state
-        pendingUpdates.clear();
+        ClearPending();
     } catch (...) {
         DisplayMessage("UpdateMyself: Unknown exception");
         // Clear updates on error to prevent corrupted state
-        pendingUpdates.clear();
+        ClearPending();
     }
 }
 
@@ -478,7 +599,9 @@ void VatIRISPlugin::PostUpdates()
         return;
     }
 
-    DWORD waitResult = WaitForSingleObject(mutex, 1000);
+    // PostJson holds the mutex for the whole request, so don't wait for it on the EuroScope thread -
+    // the updates stay pending for the next tick
+    DWORD waitResult = WaitForSingleObject(mutex, 0);
     if (waitResult == WAIT_TIMEOUT) {
         DebugMessage("Post thread is busy");
         return;
@@ -493,16 +616,38 @@ void VatIRISPlugin::PostUpdates()
         const size_t MAX_UPDATES = 1000;
         if (pendingUpdates.size() > MAX_UPDATES) {
             DebugMessage("Too many pending updates, clearing old ones");
-            pendingUpdates.clear();
+            ClearPending();
+            ReleaseMutex(mutex);
+            return;
+        }
+
+        if (updatesRejected) RequeueRejected();
+        if (pendingUpdates.empty()) {
             ReleaseMutex(mutex);
             return;
         }
 
         auto updates = pendingUpdates;
-        pendingUpdates.clear();
+        auto fields = pendingTrace;
+        ClearPending();
         DebugMessage("Posting updates " + std::to_string(updates.size()));
 
-        ThreadData *data = new ThreadData{ "backend.vatiris.se", "esdata", std::move(updates) };
+        int64_t enqueued = NowMs();
+        for (auto &[callsign, callsignFields] : fields.items()) {
+            for (auto &[field, stamp] : callsignFields.items()) {
+                int64_t ms = enqueued - stamp[0].get<int64_t>();
+                latencyStats.Record("capture-enqueue", ms);
+                if (IsUrgentField(field.c_str())) latencyStats.Record("capture-enqueue " + field, ms);
+            }
+        }
+        const char *client = ControllerMyself().GetCallsign();
+        updates["_trace"] = {
+            { "client", client ? client : "" },
+            { "enqueued", enqueued },
+            { "fields", std::move(fields) },
+        };
+
+        ThreadData *data = new ThreadData{ backendHost, "esdata", std::move(updates), backendPort, backendSecure };
         HANDLE thread = CreateThread(NULL, 0, PostJson, data, 0, NULL);
         if (!thread) {
             delete data;
@@ -513,14 +658,60 @@ void VatIRISPlugin::PostUpdates()
         CloseHandle(thread);
     } catch (const std::exception &e) {
         DisplayMessage(std::string("PostUpdates exception: ") + e.what());
-        pendingUpdates.clear(); // Clear updates on error
+        ClearPending(); // Clear updates on error
     } catch (...) {
         DisplayMessage("PostUpdates: Unknown exception");
-        pendingUpdates.clear(); // Clear updates on error
+        ClearPending(); // Clear updates on error
     }
     ReleaseMutex(mutex);
 }
 
+void VatIRISPlugin::SetPending(const std::string &callsign, const char *field, const nlohmann::json &value)
+{
+    pendingUpdates[callsign][field] = value;
+
+    // Trace from the first capture of a not yet posted value, but with the latest sequence number
+    nlohmann::json &stamp = pendingTrace[callsign][field];
+    if (stamp.is_array())
+        stamp[1] = ++traceSeq;
+    else
+        stamp = { NowMs(), ++traceSeq };
+    if (IsUrgentField(field)) urgentPending = true;
+}
+
+void VatIRISPlugin::RequeueRejected()
+{
+    // With the mutex held. Values set since the rejected post are newer and take precedence.
+    nlohmann::json rejected = std::move(rejectedUpdates);
+    rejectedUpdates = nlohmann::json();
+    updatesRejected = false;
+    if (!rejected.is_object()) return;
+
+    nlohmann::json trace;
+    if (rejected.contains("_trace")) trace = rejected["_trace"].value("fields", nlohmann::json());
+    rejected.erase("_trace");
+    for (auto &[callsign, fields] : rejected.items()) {
+        if (!fields.is_object()) continue;
+        for (auto &[field, value] : fields.items()) {
+            nlohmann::json &pending = pendingUpdates[callsign];
+            if (pending.contains(field)) continue;
+            pending[field] = value;
+            // Keep the original capture time, so latency includes the time spent rejected
+            if (trace.contains(callsign) && trace[callsign].contains(field))
+                pendingTrace[callsign][field] = trace[callsign][field];
+            if (IsUrgentField(field.c_str())) urgentPending = true;
+        }
+    }
+    DebugMessage("Re-queued updates rejected by the backend");
+}
+
+void VatIRISPlugin::ClearPending()
+{
+    pendingUpdates.clear();
+    pendingTrace.clear();
+    urgentPending = false;
+}
+
 void VatIRISPlugin::DebugMessage(const std::string &message, const std::string &sender)
 {
     if (debug) DisplayMessage(message, sender);
@@ -554,13 +745,36 @@ bool VatIRISPlugin::FilterFlightPlan(EuroScopePlugIn::CFlightPlan FlightPlan)
     }
 }
 
+void VatIRISPlugin::SetBackend(const std::string &url)
+{
+    // e.g. "https://backend.vatiris.se" or "http://localhost:5199" for a local stub server
+    std::string host = url;
+    backendSecure = true;
+    if (host.rfind("http://", 0) == 0) {
+        backendSecure = false;
+        host = host.substr(7);
+    } else if (host.rfind("https://", 0) == 0) {
+        host = host.substr(8);
+    }
+    host = host.substr(0, host.find('/'));
+
+    backendPort = backendSecure ? 443 : 80;
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        int port = std::atoi(host.c_str() + colon + 1);
+        if (port > 0 && port < 65536) backendPort = (unsigned short)port;
+        host.resize(colon);
+    }
+    backendHost = host;
+}
+
 void VatIRISPlugin::UpdateRoute(EuroScopePlugIn::CFlightPlan FlightPlan)
 {
     try {
         // Limit the size of flight updates
         if (pendingUpdates.size() > 1000) {
             DebugMessage("Too many pending updates in UpdateRoute");
-            pendingUpdates.clear();
+            ClearPending();
         }
 
         std::string callsign = FlightPlan.GetCallsign();
@@ -571,7 +785,7 @@ void VatIRISPlugin::UpdateRoute(EuroScopePlugIn::CFlightPlan FlightPlan)
 
         if (pendingUpdates.size() > 1000) {
             DebugMessage("Too many pending updates, clearing old ones");
-            pendingUpdates.clear();
+            ClearPending();
         }
 
         EuroScopePlugIn::CFlightPlanData fpData = FlightPlan.GetFlightPlanData();
@@ -583,10 +797,10 @@ void VatIRISPlugin::UpdateRoute(EuroScopePlugIn::CFlightPlan FlightPlan)
         const char *sidName = fpData.GetSidName();
 
         // Safer string handling with explicit null checks and length limits
-        if (arrRwy && *arrRwy && strlen(arrRwy) < 5) pendingUpdates[callsign]["arrRwy"] = arrRwy;
-        if (starName && *starName && strlen(starName) < 10) pendingUpdates[callsign]["star"] = starName;
-        if (depRwy && *depRwy && strlen(depRwy) < 5) pendingUpdates[callsign]["depRwy"] = depRwy;
-        if (sidName && *sidName && strlen(sidName) < 10) pendingUpdates[callsign]["sid"] = sidName;
+        if (arrRwy && *arrRwy && strlen(arrRwy) < 5) SetPending(callsign, "arrRwy", arrRwy);
+        if (starName && *starName && strlen(starName) < 10) SetPending(callsign, "star", starName);
+        if (depRwy && *depRwy && strlen(depRwy) < 5) SetPending(callsign, "depRwy", depRwy);
+        if (sidName && *sidName && strlen(sidName) < 10) SetPending(callsign, "sid", sidName);
 
         // int ete = FlightPlan.GetPositionPredictions().GetPointsNumber();
         // if (ete > 0) {
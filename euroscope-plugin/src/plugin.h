@@ -4,7 +4,9 @@
 #include "EuroScopePlugIn.h"
 #pragma warning(pop)
 
+#include "downlink.h"
 #include "json.hpp"
+#include "stands.h"
 #include <string>
 
 namespace VatIRIS
@@ -19,6 +21,15 @@ class VatIRISPlugin : public EuroScopePlugIn::CPlugIn
     void OnFlightPlanFlightPlanDataUpdate(EuroScopePlugIn::CFlightPlan FlightPlan);
     void OnFlightPlanControllerAssignedDataUpdate(EuroScopePlugIn::CFlightPlan FlightPlan, int DataType);
     void OnFlightPlanDisconnect(EuroScopePlugIn::CFlightPlan FlightPlan);
+    void OnRadarTargetPositionUpdate(EuroScopePlugIn::CRadarTarget RadarTarget);
+    void OnGetTagItem(EuroScopePlugIn::CFlightPlan FlightPlan,
+                      EuroScopePlugIn::CRadarTarget RadarTarget,
+                      int ItemCode,
+                      int TagData,
+                      char sItemString[16],
+                      int *pColorCode,
+                      COLORREF *pRGB,
+                      double *pFontSize);
     bool OnCompileCommand(const char *commandLine);
     void OnTimer(int counter);
 
@@ -30,11 +41,26 @@ class VatIRISPlugin : public EuroScopePlugIn::CPlugIn
     void DisplayMessage(const std::string &message, const std::string &sender = "VatIRIS");
     bool FilterFlightPlan(EuroScopePlugIn::CFlightPlan FlightPlan);
     void UpdateRoute(EuroScopePlugIn::CFlightPlan FlightPlan);
+    void SetBackend(const std::string &url);
+    void SetPending(const std::string &callsign, const char *field, const nlohmann::json &value);
+    void ClearPending();
+    void RequeueRejected();
+    void PublishStand(const std::string &callsign, const Stand *stand);
+    void ExpireStands();
 
     bool disabled;
     bool updateAll;
     bool debug;
     nlohmann::json pendingUpdates;
+    nlohmann::json pendingTrace; // callsign -> field -> [capture time, sequence number]
+    bool urgentPending;
+    uint64_t traceSeq;
+    StandIndex standIndex;
+    StandOccupancy standOccupancy;
+    DownlinkCache downlink;
+    std::string backendHost;
+    unsigned short backendPort;
+    bool backendSecure;
     std::time_t lastUpdateTime, lastPostTime, enabledTime;
 };
 } // namespace VatIRIS
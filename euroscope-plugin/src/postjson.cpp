@@ -1,4 +1,5 @@
 #include "postjson.h"
+#include "latency.h"
 #include <sstream>
 #include <wininet.h>
 
@@ -8,6 +9,9 @@ namespace VatIRIS
 {
 HANDLE mutex = NULL;
 std::string connectionError;
+nlohmann::json rejectedUpdates;
+std::atomic<bool> updatesRejected = false;
+std::atomic<int64_t> lastRoundTripMs = -1;
 
 DWORD WINAPI PostJson(LPVOID lpParameter)
 {
@@ -34,7 +38,7 @@ DWORD WINAPI PostJson(LPVOID lpParameter)
             return 1;
         }
 
-        HINTERNET hConnect = InternetConnectA(hInternet, data->host.c_str(), INTERNET_DEFAULT_HTTPS_PORT,
+        HINTERNET hConnect = InternetConnectA(hInternet, data->host.c_str(), data->port,
                                             NULL, NULL, INTERNET_SERVICE_HTTP, 0, 0);
         if (!hConnect) {
             err << "Failed to connect: " << GetLastError();
@@ -47,7 +51,7 @@ DWORD WINAPI PostJson(LPVOID lpParameter)
 
         const char *acceptTypes[] = { "application/json", NULL };
         HINTERNET hRequest = HttpOpenRequestA(hConnect, "POST", data->path.c_str(), NULL, NULL,
-                                            acceptTypes, INTERNET_FLAG_SECURE | INTERNET_FLAG_RELOAD, 0);
+                                            acceptTypes, (data->secure ? INTERNET_FLAG_SECURE : 0) | INTERNET_FLAG_RELOAD, 0);
         if (!hRequest) {
             err << "Failed to open request: " << GetLastError();
             InternetCloseHandle(hConnect);
@@ -58,6 +62,13 @@ DWORD WINAPI PostJson(LPVOID lpParameter)
             return 1;
         }
 
+        int64_t sent = NowMs();
+        if (data->jsonData.contains("_trace")) {
+            data->jsonData["_trace"]["sent"] = sent;
+            int64_t rtt = lastRoundTripMs;
+            if (rtt >= 0) data->jsonData["_trace"]["rtt"] = rtt;
+            latencyStats.Record("enqueue-send", sent - data->jsonData["_trace"].value("enqueued", sent));
+        }
         std::string jsonString = data->jsonData.dump();
         std::string headers = "Content-Type: application/json\r\n";
 
@@ -73,6 +84,21 @@ DWORD WINAPI PostJson(LPVOID lpParameter)
             return 1;
         }
 
+        int64_t rtt = NowMs() - sent;
+        latencyStats.Record("send-response", rtt);
+        lastRoundTripMs = rtt;
+
+        DWORD status = 0;
+        DWORD size = sizeof(status);
+        DWORD query = HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER;
+        HttpQueryInfoA(hRequest, query, &status, &size, NULL);
+        if (status == 429) {
+            // Rate limited - nothing was merged, so keep the batch for the next post. Still holding
+            // the mutex, and PostUpdates takes any earlier rejected batch before posting again.
+            rejectedUpdates = std::move(data->jsonData);
+            updatesRejected = true;
+        }
+
         InternetCloseHandle(hRequest);
         InternetCloseHandle(hConnect);
         InternetCloseHandle(hInternet);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "json.hpp"
+#include <atomic>
 #include <string>
 #include <windows.h>
 
@@ -10,6 +11,8 @@ struct ThreadData {
     std::string host;
     std::string path;
     nlohmann::json jsonData;
+    unsigned short port = 443;
+    bool secure = true;
 };
 
 // Function declaration
@@ -18,4 +21,11 @@ DWORD WINAPI PostJson(LPVOID lpParameter);
 // Global variables declarations
 extern HANDLE mutex;
 extern std::string connectionError;
+// Batch the backend rejected with 429 Too Many Requests, guarded by mutex - re-queued by the
+// plugin on its next post
+extern nlohmann::json rejectedUpdates;
+extern std::atomic<bool> updatesRejected;
+// Send-response time of the last post, -1 before the first - sent in the next trace so the backend
+// can estimate network transit from one clock (half of it) instead of comparing ours with its own
+extern std::atomic<int64_t> lastRoundTripMs;
 } // namespace VatIRIS
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "stands.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace VatIRIS
+{
+
+// Roughly 200 m cells at Swedish latitudes - larger than any stand, so most stands span 1-4 cells
+const double CELL_SIZE_LAT = 0.002;
+const double CELL_SIZE_LON = 0.004;
+const double DEFAULT_STAND_RADIUS = 20.0; // same as the frontend, for stands without coords/radius
+const double METERS_PER_DEGREE_LAT = 111320.0;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+const int STAND_CONFIRM_UPDATES = 3;
+
+static double DistanceMeters(double lat1, double lon1, double lat2, double lon2)
+{
+    // Equirectangular approximation - plenty for distances within an apron
+    double dy = (lat2 - lat1) * METERS_PER_DEGREE_LAT;
+    double dx = (lon2 - lon1) * METERS_PER_DEGREE_LAT * std::cos((lat1 + lat2) * 0.5 * DEG_TO_RAD);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+static double ParseRadius(const nlohmann::json &value)
+{
+    try {
+        if (value.is_number()) return value.get<double>();
+        if (value.is_string()) return std::stod(value.get<std::string>());
+    } catch (...) {
+    }
+    return 0.0;
+}
+
+size_t StandIndex::Load(const nlohmann::json &data)
+{
+    stands.clear();
+    cells.clear();
+    if (!data.is_object()) return 0;
+
+    for (auto &[airport, airportStands] : data.items()) {
+        if (!airportStands.is_object()) continue;
+        for (auto &[name, standData] : airportStands.items()) {
+            const nlohmann::json &center = standData.value("center", nlohmann::json());
+            if (!center.is_array() || center.size() < 2) continue;
+
+            Stand stand;
+            stand.airport = airport;
+            stand.name = name;
+            stand.centerLon = center[0].get<double>();
+            stand.centerLat = center[1].get<double>();
+            stand.radius = standData.contains("radius") ? ParseRadius(standData["radius"]) : 0.0;
+
+            const nlohmann::json &coords = standData.value("coords", nlohmann::json());
+            if (coords.is_array() && coords.size() >= 3) {
+                for (auto &coord : coords) {
+                    if (!coord.is_array() || coord.size() < 2) continue;
+                    stand.coords.emplace_back(coord[1].get<double>(), coord[0].get<double>());
+                }
+            }
+            if (stand.coords.size() < 3) stand.coords.clear();
+            if (stand.coords.empty() && stand.radius <= 0.0) stand.radius = DEFAULT_STAND_RADIUS;
+
+            double minLat = stand.centerLat, maxLat = stand.centerLat;
+            double minLon = stand.centerLon, maxLon = stand.centerLon;
+            if (!stand.coords.empty()) {
+                for (auto &[lat, lon] : stand.coords) {
+                    minLat = std::min(minLat, lat);
+                    maxLat = std::max(maxLat, lat);
+                    minLon = std::min(minLon, lon);
+                    maxLon = std::max(maxLon, lon);
+                }
+            }
+            if (stand.radius > 0.0) {
+                double dLat = stand.radius / METERS_PER_DEGREE_LAT;
+                double dLon = dLat / std::cos(stand.centerLat * DEG_TO_RAD);
+                minLat = std::min(minLat, stand.centerLat - dLat);
+                maxLat = std::max(maxLat, stand.centerLat + dLat);
+                minLon = std::min(minLon, stand.centerLon - dLon);
+                maxLon = std::max(maxLon, stand.centerLon + dLon);
+            }
+
+            stands.push_back(std::move(stand));
+            Insert((uint32_t)(stands.size() - 1), minLat, minLon, maxLat, maxLon);
+        }
+    }
+    return stands.size();
+}
+
+size_t StandIndex::LoadFile(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) return 0;
+    nlohmann::json data = nlohmann::json::parse(file, nullptr, false);
+    if (data.is_discarded()) return 0;
+    return Load(data);
+}
+
+const Stand *StandIndex::Find(double lat, double lon) const
+{
+    int64_t latCell = (int64_t)std::floor(lat / CELL_SIZE_LAT);
+    int64_t lonCell = (int64_t)std::floor(lon / CELL_SIZE_LON);
+    auto cell = cells.find(CellKey(latCell, lonCell));
+    if (cell == cells.end()) return nullptr;
+
+    // Overlapping stands (e.g. MARS stands) - pick the one with the nearest center, like the frontend
+    const Stand *nearest = nullptr;
+    double nearestDistance = 0.0;
+    for (uint32_t index : cell->second) {
+        const Stand &stand = stands[index];
+        if (!Contains(stand, lat, lon)) continue;
+        double distance = DistanceMeters(lat, lon, stand.centerLat, stand.centerLon);
+        if (!nearest || distance < nearestDistance) {
+            nearest = &stand;
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+int64_t StandIndex::CellKey(int64_t latCell, int64_t lonCell)
+{
+    return (latCell << 32) ^ (lonCell & 0xffffffff);
+}
+
+void StandIndex::Insert(uint32_t index, double minLat, double minLon, double maxLat, double maxLon)
+{
+    int64_t latCell0 = (int64_t)std::floor(minLat / CELL_SIZE_LAT);
+    int64_t latCell1 = (int64_t)std::floor(maxLat / CELL_SIZE_LAT);
+    int64_t lonCell0 = (int64_t)std::floor(minLon / CELL_SIZE_LON);
+    int64_t lonCell1 = (int64_t)std::floor(maxLon / CELL_SIZE_LON);
+    for (int64_t latCell = latCell0; latCell <= latCell1; latCell++)
+        for (int64_t lonCell = lonCell0; lonCell <= lonCell1; lonCell++)
+            cells[CellKey(latCell, lonCell)].push_back(index);
+}
+
+bool StandIndex::Contains(const Stand &stand, double lat, double lon)
+{
+    if (stand.coords.empty())
+        return DistanceMeters(lat, lon, stand.centerLat, stand.centerLon) < stand.radius;
+
+    // Ray casting point-in-polygon
+    bool inside = false;
+    size_t n = stand.coords.size();
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        auto &[latI, lonI] = stand.coords[i];
+        auto &[latJ, lonJ] = stand.coords[j];
+        if ((latI > lat) != (latJ > lat) && lon < (lonJ - lonI) * (lat - latI) / (latJ - latI) + lonI)
+            inside = !inside;
+    }
+    return inside;
+}
+
+bool StandOccupancy::Update(const std::string &callsign, const Stand *observed, std::time_t now)
+{
+    auto it = tracks.find(callsign);
+    if (it == tracks.end()) {
+        if (!observed) return false; // not on a stand and never was - nothing to track
+        it = tracks.emplace(callsign, Track()).first;
+    }
+
+    Track &track = it->second;
+    track.lastSeen = now;
+    if (observed == track.stand) {
+        if (!track.stand) {
+            tracks.erase(it); // passed through a stand without stopping
+        } else {
+            track.candidate = nullptr;
+            track.hits = 0;
+        }
+        return false;
+    }
+
+    if (observed == track.candidate) {
+        track.hits++;
+    } else {
+        track.candidate = observed;
+        track.hits = 1;
+    }
+    if (track.hits < STAND_CONFIRM_UPDATES) return false;
+
+    track.stand = track.candidate;
+    track.candidate = nullptr;
+    track.hits = 0;
+    if (!track.stand) tracks.erase(it);
+    return true;
+}
+
+const Stand *StandOccupancy::Get(const std::string &callsign) const
+{
+    auto it = tracks.find(callsign);
+    return it == tracks.end() ? nullptr : it->second.stand;
+}
+
+bool StandOccupancy::IsPublished(const std::string &callsign) const
+{
+    auto it = tracks.find(callsign);
+    return it != tracks.end() && it->second.stand && it->second.published;
+}
+
+void StandOccupancy::MarkPublished(const std::string &callsign)
+{
+    auto it = tracks.find(callsign);
+    if (it != tracks.end()) it->second.published = true;
+}
+
+std::vector<std::string> StandOccupancy::RemoveStale(std::time_t before)
+{
+    std::vector<std::string> vacated;
+    for (auto it = tracks.begin(); it != tracks.end();) {
+        if (it->second.lastSeen >= before) {
+            ++it;
+            continue;
+        }
+        if (it->second.stand && it->second.published) vacated.push_back(it->first);
+        it = tracks.erase(it);
+    }
+    return vacated;
+}
+
+} // namespace VatIRIS
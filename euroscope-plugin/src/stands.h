@@ -0,0 +1,70 @@
+#pragma once
+
+#include "json.hpp"
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VatIRIS
+{
+
+struct Stand {
+    std::string airport;
+    std::string name;
+    double centerLat, centerLon;
+    double radius; // meters, used when there is no polygon
+    std::vector<std::pair<double, double>> coords; // lat, lon
+};
+
+// Stands from the generated stands.json (see scripts/generate-stands.py), bucketed into a uniform
+// lat/lon grid so a position lookup only tests the handful of stands sharing its cell.
+class StandIndex
+{
+    public:
+    size_t Load(const nlohmann::json &data);
+    size_t LoadFile(const std::string &path);
+    const Stand *Find(double lat, double lon) const;
+    size_t Size() const { return stands.size(); }
+
+    private:
+    static int64_t CellKey(int64_t latCell, int64_t lonCell);
+    void Insert(uint32_t index, double minLat, double minLon, double maxLat, double maxLon);
+    static bool Contains(const Stand &stand, double lat, double lon);
+
+    std::vector<Stand> stands;
+    std::unordered_map<int64_t, std::vector<uint32_t>> cells;
+};
+
+// Per-callsign stand classification with hysteresis - a new stand (or leaving one) is only
+// committed after it has been observed for a number of consecutive position updates. Stands are
+// pointers into the StandIndex, which is loaded once and must outlive the tracks.
+class StandOccupancy
+{
+    public:
+    // Returns true if the committed stand for the callsign changed
+    bool Update(const std::string &callsign, const Stand *observed, std::time_t now);
+    const Stand *Get(const std::string &callsign) const;
+    bool IsTracked(const std::string &callsign) const { return tracks.count(callsign) > 0; }
+    void Remove(const std::string &callsign) { tracks.erase(callsign); }
+    void Clear() { tracks.clear(); }
+    // Whether a committed stand has been published for the callsign, i.e. needs a vacated update
+    bool IsPublished(const std::string &callsign) const;
+    void MarkPublished(const std::string &callsign);
+    // Drops tracks without a position update since before, e.g. radar targets that disappeared
+    // without a flight plan disconnect. Returns the callsigns that had a published stand.
+    std::vector<std::string> RemoveStale(std::time_t before);
+
+    private:
+    struct Track {
+        const Stand *stand = nullptr;
+        const Stand *candidate = nullptr;
+        int hits = 0;
+        std::time_t lastSeen = 0;
+        bool published = false;
+    };
+    std::unordered_map<std::string, Track> tracks;
+};
+
+} // namespace VatIRIS
@@ -5,6 +5,7 @@ data = {}
 
 input_file = f"{os.environ.get('APPDATA')}\\EuroScope\\ESAA\\Plugins\\GRpluginStands.txt"
 output_file = os.path.join(os.path.dirname(__file__), '../frontend/src/data/stands.json')
+plugin_output_file = f"{os.environ.get('APPDATA')}\\EuroScope\\ESAA\\Plugins\\VatIRISStands.json"
 
 
 def convert_lonlat(lon, lat):
@@ -61,3 +62,8 @@ for airport in data:
 with open(output_file, 'w') as json_file:
     json.dump(data, json_file, indent=4)
 
+# ... and a compact copy for the VatIRIS EuroScope plugin stand occupancy detection
+if os.path.isdir(os.path.dirname(plugin_output_file)):
+    with open(plugin_output_file, 'w') as json_file:
+        json.dump(data, json_file)
+